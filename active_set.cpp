@@ -0,0 +1,229 @@
+/**
+ * Active Set Tracking
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #include <algorithm>
+ #include <cstdlib>
+
+ #include <omp.h>
+ #include "active_set.h"
+
+ ActiveSet::ActiveSet(int dim_x, int dim_y) {
+     blocks_x = (dim_x + block_size - 1) / block_size;
+     blocks_y = (dim_y + block_size - 1) / block_size;
+ }
+
+ long long ActiveSet::num_blocks(int dim_x, int dim_y) {
+     return (long long)((dim_x + block_size - 1) / block_size) * ((dim_y + block_size - 1) / block_size);
+ }
+
+ // a rebuild only clears the blocks around the agents' old places instead of
+ // the whole grid, so it stays cheap enough to follow every reorder
+ void ActiveSet::build(const std::vector<Agent>& agents, int num_agents) {
+     if (near.empty()) {
+         near.assign((size_t)blocks_x * blocks_y, 0);
+         head.assign((size_t)blocks_x * blocks_y, -1);
+     }
+     else {
+         for (int block : block_of) {
+             for_each_around(block, [&](int b) {
+                 near[b] = 0;
+                 head[b] = -1;
+             });
+         }
+     }
+     block_of.resize(num_agents);
+     prev.resize(num_agents);
+     next.resize(num_agents);
+     slot.assign(num_agents, -1);
+     active.clear();
+
+     for (int i = 0; i < num_agents; i++) {
+         link(i, block_index(agents[i]));
+         adjust_near(block_of[i], 1);
+     }
+     for (int i = 0; i < num_agents; i++) {
+         set_active(i, near[block_of[i]] >= 2);
+     }
+ }
+
+ // Finds the agents that changed block and compacts them with a prefix sum
+ // over the threads' counts; everything after that only looks at them. One
+ // thread moves them between the block lists while the others change the
+ // counts with atomics. Only the blocks near one end of a move and not the
+ // other change, three and three for a move to the next block, and a block's
+ // agents can only switch when its count passes two, which the atomic
+ // itself shows, so those blocks and the movers are all that is looked at
+ // again.
+ void ActiveSet::update(const std::vector<Agent>& agents, int num_agents) {
+     int max_threads = omp_get_max_threads();
+     thread_moved.assign(max_threads + 1, 0);
+     thread_crossed.resize(max_threads);
+
+     #pragma omp parallel
+     {
+         int t = omp_get_thread_num();
+         std::vector<int>& crossed = thread_crossed[t];
+         crossed.clear();
+
+         // both loops split the agents the same way (static, same count), so
+         // each thread writes its movers from its own offset in order
+         int count = 0;
+         #pragma omp for schedule(static) nowait
+         for (int i = 0; i < num_agents; i++) {
+             count += (block_index(agents[i]) != block_of[i]);
+         }
+         thread_moved[t + 1] = count;
+         #pragma omp barrier
+
+         #pragma omp single
+         {
+             for (int k = 0; k < max_threads; k++) {
+                 thread_moved[k + 1] += thread_moved[k];
+             }
+             moved.resize(thread_moved[max_threads]);
+             moved_from.resize(moved.size());
+             moved_to.resize(moved.size());
+         }
+
+         int next_slot = thread_moved[t];
+         #pragma omp for schedule(static)
+         for (int i = 0; i < num_agents; i++) {
+             int block = block_index(agents[i]);
+             if (block != block_of[i]) {
+                 moved[next_slot] = i;
+                 moved_from[next_slot] = block_of[i];
+                 moved_to[next_slot] = block;
+                 next_slot++;
+             }
+         }
+
+         int num_moved = (int)moved.size();
+
+         // in a large grid the lists and counts of the movers lie far apart,
+         // so both loops fetch the ones a few movers ahead early; every
+         // atomic otherwise waits for its own miss
+         #pragma omp single nowait
+         for (int k = 0; k < num_moved; k++) {
+             if (k + prefetch_distance < num_moved) {
+                 prefetch_links(moved[k + prefetch_distance], moved_to[k + prefetch_distance]);
+             }
+             unlink(moved[k]);
+             link(moved[k], moved_to[k]);
+         }
+
+         // dynamic, so the others take over the share of the thread that is
+         // still relinking
+         #pragma omp for schedule(dynamic, 256)
+         for (int k = 0; k < num_moved; k++) {
+             if (k + prefetch_distance < num_moved) {
+                 prefetch_near(moved_from[k + prefetch_distance]);
+                 prefetch_near(moved_to[k + prefetch_distance]);
+             }
+             move_near(moved_from[k], moved_to[k], crossed);
+         }
+
+         // the active list is a swap-pop array, so its few changes are made
+         // by one thread; a block listed twice is just checked twice
+         #pragma omp single
+         {
+             for (int k = 0; k < num_moved; k++) {
+                 set_active(moved[k], near[moved_to[k]] >= 2);
+             }
+             for (const std::vector<int>& blocks : thread_crossed) {
+                 for (int b : blocks) {
+                     for (int k = head[b]; k != -1; k = next[k]) {
+                         set_active(k, near[b] >= 2);
+                     }
+                 }
+             }
+         }
+     }
+ }
+
+ // the counts around from and not around to lose the agent, the ones around
+ // to and not around from gain it
+ void ActiveSet::move_near(int from, int to, std::vector<int>& crossed) {
+     int fx = from % blocks_x;
+     int fy = from / blocks_x;
+     int tx = to % blocks_x;
+     int ty = to / blocks_x;
+     for (int y = std::max(fy - 1, 0); y <= std::min(fy + 1, blocks_y - 1); y++) {
+         for (int x = std::max(fx - 1, 0); x <= std::min(fx + 1, blocks_x - 1); x++) {
+             if (std::abs(x - tx) <= 1 && std::abs(y - ty) <= 1) {
+                 continue;
+             }
+             int b = y * blocks_x + x;
+             int was;
+             #pragma omp atomic capture
+             was = near[b]--;
+             if (was == 2) {
+                 crossed.push_back(b);
+             }
+         }
+     }
+     for (int y = std::max(ty - 1, 0); y <= std::min(ty + 1, blocks_y - 1); y++) {
+         for (int x = std::max(tx - 1, 0); x <= std::min(tx + 1, blocks_x - 1); x++) {
+             if (std::abs(x - fx) <= 1 && std::abs(y - fy) <= 1) {
+                 continue;
+             }
+             int b = y * blocks_x + x;
+             int was;
+             #pragma omp atomic capture
+             was = near[b]++;
+             if (was == 1) {
+                 crossed.push_back(b);
+             }
+         }
+     }
+ }
+
+ void ActiveSet::link(int i, int block) {
+     block_of[i] = block;
+     prev[i] = -1;
+     next[i] = head[block];
+     if (head[block] != -1) {
+         prev[head[block]] = i;
+     }
+     head[block] = i;
+ }
+
+ void ActiveSet::unlink(int i) {
+     if (prev[i] != -1) {
+         next[prev[i]] = next[i];
+     }
+     else {
+         head[block_of[i]] = next[i];
+     }
+     if (next[i] != -1) {
+         prev[next[i]] = prev[i];
+     }
+ }
+
+ // a count going from 1 to 2 or back leaves at most two agents in the block,
+ // which switch together; any other change switches nobody
+ void ActiveSet::adjust_near(int block, int delta) {
+     for_each_around(block, [&](int b) {
+         near[b] += delta;
+         if ((delta > 0 && near[b] == 2) || (delta < 0 && near[b] == 1)) {
+             for (int k = head[b]; k != -1; k = next[k]) {
+                 set_active(k, near[b] >= 2);
+             }
+         }
+     });
+ }
+
+ void ActiveSet::set_active(int i, bool on) {
+     if (on && slot[i] == -1) {
+         slot[i] = (int)active.size();
+         active.push_back(i);
+     }
+     else if (!on && slot[i] != -1) {
+         int last = active.back();
+         active[slot[i]] = last;
+         slot[last] = slot[i];
+         active.pop_back();
+         slot[i] = -1;
+     }
+ }
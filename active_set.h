@@ -0,0 +1,102 @@
+/**
+ * Active Set Tracking (Header file)
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #ifndef ACTIVE_SET_H
+ #define ACTIVE_SET_H
+
+ #include <algorithm>
+ #include <vector>
+ #include "agent.h"
+
+ // The agents that have somebody close enough to collide with. Two agents can
+ // only collide when they stand within two cells of each other, so the grid
+ // is split into blocks of block_size cells (at least 2) and an agent counts
+ // as active when its block and the eight around it hold another agent.
+ // Every block keeps that 3x3 head count and a linked list of its agents. An
+ // agent that changes block moves between two lists and adjusts the counts
+ // around one block and not the other, and only a count crossing two can
+ // switch anybody in or out, so the list of active agents is kept up to date
+ // without ever looking at the agents that stay alone.
+ class ActiveSet {
+     public:
+         static const int block_size = 4;
+
+         // the agents with a possible neighbour, in no particular order
+         std::vector<int> active;
+
+         ActiveSet(int dim_x, int dim_y);
+
+         static long long num_blocks(int dim_x, int dim_y);
+
+         // starts over from the agents' current positions, e.g. once the
+         // agents have been renumbered
+         void build(const std::vector<Agent>& agents, int num_agents);
+         // moves the agents whose current position left their block; opens
+         // a parallel region of its own
+         void update(const std::vector<Agent>& agents, int num_agents);
+
+     private:
+         int blocks_x, blocks_y;
+         // per block: agents in it and the eight around it, first agent
+         std::vector<int> near;
+         std::vector<int> head;
+         // per agent: block, neighbours in its block's list, index in active
+         std::vector<int> block_of;
+         std::vector<int> prev, next;
+         std::vector<int> slot;
+         // update(): the agents that changed block with their old and new
+         // block, each thread's offset among them, and the blocks whose
+         // count each thread saw pass two
+         std::vector<int> moved, moved_from, moved_to;
+         std::vector<int> thread_moved;
+         std::vector<std::vector<int>> thread_crossed;
+
+         int block_index(const Agent& agent) const {
+             return (agent.y_pos / block_size) * blocks_x + agent.x_pos / block_size;
+         }
+
+         // the block and the eight around it that are on the grid
+         template <typename F>
+         void for_each_around(int block, F f) const {
+             int bx = block % blocks_x;
+             int by = block / blocks_x;
+             for (int y = std::max(by - 1, 0); y <= std::min(by + 1, blocks_y - 1); y++) {
+                 for (int x = std::max(bx - 1, 0); x <= std::min(bx + 1, blocks_x - 1); x++) {
+                     f(y * blocks_x + x);
+                 }
+             }
+         }
+
+         static const int prefetch_distance = 8;
+
+         // the rows of counts around block
+         void prefetch_near(int block) const {
+             for (int b = block - blocks_x; b <= block + blocks_x; b += blocks_x) {
+                 if (b >= 0 && b < (int)near.size()) {
+                     __builtin_prefetch(&near[b], 1);
+                 }
+             }
+         }
+
+         // what unlinking agent i and linking it into block touches
+         void prefetch_links(int i, int block) const {
+             __builtin_prefetch(&head[block], 1);
+             __builtin_prefetch(&head[block_of[i]], 1);
+             if (prev[i] != -1) {
+                 __builtin_prefetch(&next[prev[i]], 1);
+             }
+             if (next[i] != -1) {
+                 __builtin_prefetch(&prev[next[i]], 1);
+             }
+         }
+
+         void link(int i, int block);
+         void unlink(int i);
+         void adjust_near(int block, int delta);
+         void move_near(int from, int to, std::vector<int>& crossed);
+         void set_active(int i, bool on);
+ };
+
+ #endif
@@ -0,0 +1,14 @@
+/**
+ * Agent Structure (Header file)
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #ifndef AGENT_H
+ #define AGENT_H
+
+ struct Agent {
+    int x_pos, y_pos, dir, next_x, next_y;
+    int id;
+ };
+
+ #endif
@@ -0,0 +1,122 @@
+/**
+ * Structure-of-Arrays Agent Store
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #include <cstdint>
+ #include <vector>
+
+ #include <omp.h>
+ #include "agent_soa.h"
+ #include "rng.h"
+
+ void AgentSoA::resize(int n) {
+     num_agents = n;
+     x.resize(n);
+     y.resize(n);
+     next_x.resize(n);
+     next_y.resize(n);
+     dir.resize(n);
+ }
+
+ void AgentSoA::load(const std::vector<Agent>& agents) {
+     resize((int)agents.size());
+
+     #pragma omp parallel for
+     for (int i = 0; i < num_agents; i++) {
+         x[i] = agents[i].x_pos;
+         y[i] = agents[i].y_pos;
+         next_x[i] = agents[i].next_x;
+         next_y[i] = agents[i].next_y;
+         dir[i] = agents[i].dir;
+     }
+ }
+
+ void AgentSoA::store(std::vector<Agent>& agents) const {
+     #pragma omp parallel for
+     for (int i = 0; i < num_agents; i++) {
+         agents[i].x_pos = x[i];
+         agents[i].y_pos = y[i];
+         agents[i].next_x = next_x[i];
+         agents[i].next_y = next_y[i];
+         agents[i].dir = dir[i];
+     }
+ }
+
+ bool AgentSoA::in_range(int dim_x, int dim_y) const {
+     for (int i = 0; i < num_agents; i++) {
+         if (x[i] > dim_x-1 || y[i] > dim_y-1) {
+             return false;
+         }
+     }
+     return true;
+ }
+
+ // Same rules as move_agent, written as selects so the loop vectorizes:
+ // corners pick one of their two exits at random, agents walking into a wall
+ // reverse (dir ^ 2), everyone else keeps going. dir 4 stays put.
+ void move_agents_soa(AgentSoA& soa, int dimX, int dimY, uint64_t seed, int step) {
+     uint16_t *xs = soa.x.data(), *ys = soa.y.data();
+     uint16_t *next_xs = soa.next_x.data(), *next_ys = soa.next_y.data();
+     uint8_t *dirs = soa.dir.data();
+
+     #pragma omp parallel for simd schedule(static)
+     for (int i = 0; i < soa.num_agents; i++) {
+         int x = xs[i];
+         int y = ys[i];
+         int d = dirs[i];
+
+         int left = x == 0;
+         int right = x == dimX-1;
+         int top = y == 0;
+         int bottom = y == dimY-1;
+
+         int corner = (left | right) & (top | bottom);
+         int into_wall = (right & (d == 1)) | (left & (d == 3)) | (bottom & (d == 2)) | (top & (d == 0));
+
+         // top left takes E on a 0 draw, the other three corners take N/S
+         int vertical = corner_coin(seed, i, step) ^ (1 - (left & top));
+         int corner_dir = vertical ? (top ? 2 : 0) : (left ? 1 : 3);
+
+         int direction = corner ? corner_dir : (into_wall ? (d ^ 2) : d);
+
+         next_xs[i] = (uint16_t)(x + (direction == 1) - (direction == 3));
+         next_ys[i] = (uint16_t)(y + (direction == 2) - (direction == 0));
+         dirs[i] = (uint8_t)direction;
+     }
+ }
+
+ // turn the agent around and step back the way it came, staying put at a wall
+ static inline void bounce_soa(AgentSoA& soa, int i, int dimX, int dimY) {
+     int d = soa.dir[i];
+     int direction = d == 4 ? 1 : (d ^ 2);
+
+     int nx = soa.x[i] + (direction == 1) - (direction == 3);
+     int ny = soa.y[i] + (direction == 2) - (direction == 0);
+
+     soa.next_x[i] = (nx < 0 || nx > dimX-1) ? soa.x[i] : (uint16_t)nx;
+     soa.next_y[i] = (ny < 0 || ny > dimY-1) ? soa.y[i] : (uint16_t)ny;
+     soa.dir[i] = (uint8_t)direction;
+ }
+
+ void resolve_collisions_soa(const std::vector<int>& colliders, AgentSoA& soa, int dimX, int dimY) {
+     #pragma omp parallel for schedule(dynamic)
+     for (int i = 0; i < soa.num_agents; i++) {
+         int collider_id = colliders[i];
+         if (collider_id != -1 && collider_id > i) {
+             bounce_soa(soa, i, dimX, dimY);
+             bounce_soa(soa, collider_id, dimX, dimY);
+         }
+     }
+ }
+
+ void commit_positions_soa(AgentSoA& soa) {
+     uint16_t *xs = soa.x.data(), *ys = soa.y.data();
+     const uint16_t *next_xs = soa.next_x.data(), *next_ys = soa.next_y.data();
+
+     #pragma omp parallel for simd schedule(static)
+     for (int i = 0; i < soa.num_agents; i++) {
+         xs[i] = next_xs[i];
+         ys[i] = next_ys[i];
+     }
+ }
@@ -0,0 +1,33 @@
+/**
+ * Structure-of-Arrays Agent Store (Header file)
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #ifndef AGENT_SOA_H
+ #define AGENT_SOA_H
+
+ #include <cstdint>
+ #include <vector>
+ #include "agent.h"
+
+ // Coordinates fit in 16 bits for grids up to 65536x65536, so one agent costs
+ // 9 bytes here instead of the 24 bytes of Agent.
+ const int soa_max_dim = 65536;
+
+ struct AgentSoA {
+     int num_agents = 0;
+     std::vector<uint16_t> x, y;
+     std::vector<uint16_t> next_x, next_y;
+     std::vector<uint8_t> dir;
+
+     void resize(int n);
+     void load(const std::vector<Agent>& agents);
+     void store(std::vector<Agent>& agents) const;
+     bool in_range(int dim_x, int dim_y) const;
+ };
+
+ void move_agents_soa(AgentSoA& soa, int dimX, int dimY, uint64_t seed, int step);
+ void resolve_collisions_soa(const std::vector<int>& colliders, AgentSoA& soa, int dimX, int dimY);
+ void commit_positions_soa(AgentSoA& soa);
+
+ #endif
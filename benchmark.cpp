@@ -0,0 +1,323 @@
+/**
+ * Benchmark Driver
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ *
+ * Runs the serial, parallel and no_quadtree binaries over a sweep of inputs,
+ * engines, thread counts and iteration counts, repeats every configuration,
+ * and reports the median and standard deviation of the "Initialization time"
+ * and "Computation time" each run prints. Lists are comma separated, e.g.
+ *     ./benchmark -t parallel -e grid,linear -f inputs/dense.txt -n 1,2,4,8 -o out.json
+ * A reorder interval of 0 runs parallel without -r.
+ * Results go to stdout as CSV, or to -o as CSV or JSON by file extension.
+ */
+
+ #include <algorithm>
+ #include <cmath>
+ #include <cstdio>
+ #include <fstream>
+ #include <iomanip>
+ #include <iostream>
+ #include <sstream>
+ #include <string>
+ #include <vector>
+
+ #include <unistd.h>
+
+ const std::vector<std::string> targets = {"serial", "parallel", "no_quadtree"};
+ const std::vector<std::string> engines = {"quadtree", "leaves", "grid", "linear", "concurrent", "bitmap", "sort", "hash", "verlet"};
+ const std::vector<std::string> modes = {"regions", "persistent", "tiled", "events"};
+
+ struct Stats {
+     double median = 0;
+     double stddev = 0;
+ };
+
+ struct Result {
+     std::string target, engine, mode, input;
+     int threads, iterations, reorder, runs;
+     Stats init, compute;
+ };
+
+ std::vector<std::string> split_list(const std::string& list) {
+     std::vector<std::string> items;
+     std::stringstream ss(list);
+     std::string item;
+     while (std::getline(ss, item, ',')) {
+         if (!item.empty()) {
+             items.push_back(item);
+         }
+     }
+     return items;
+ }
+
+ std::vector<int> split_ints(const std::string& list) {
+     std::vector<int> values;
+     for (const auto& item : split_list(list)) {
+         values.push_back(atoi(item.c_str()));
+     }
+     return values;
+ }
+
+ Stats summarize(std::vector<double> samples) {
+     Stats stats;
+     int n = (int)samples.size();
+     if (n == 0) {
+         return stats;
+     }
+     std::sort(samples.begin(), samples.end());
+     stats.median = (n % 2) ? samples[n/2] : 0.5 * (samples[n/2 - 1] + samples[n/2]);
+
+     double mean = 0;
+     for (double s : samples) {
+         mean += s;
+     }
+     mean /= n;
+     double var = 0;
+     for (double s : samples) {
+         var += (s - mean) * (s - mean);
+     }
+     stats.stddev = (n > 1) ? std::sqrt(var / (n - 1)) : 0.0;
+     return stats;
+ }
+
+ // Runs one command and pulls the two timing lines out of its output.
+ // Returns false if the run failed or did not print both times.
+ bool run_once(const std::string& command, double& init_time, double& compute_time) {
+     FILE *pipe = popen((command + " 2>&1").c_str(), "r");
+     if (pipe == nullptr) {
+         return false;
+     }
+
+     bool have_init = false, have_compute = false;
+     std::string output;
+     char line[512];
+     while (fgets(line, sizeof(line), pipe) != nullptr) {
+         output += line;
+         if (sscanf(line, "Initialization time (sec): %lf", &init_time) == 1) {
+             have_init = true;
+         }
+         else if (sscanf(line, "Computation time (sec): %lf", &compute_time) == 1) {
+             have_compute = true;
+         }
+     }
+
+     int status = pclose(pipe);
+     if (status != 0 || !have_init || !have_compute) {
+         std::cerr << "Run failed: " << command << "\n" << output;
+         return false;
+     }
+     return true;
+ }
+
+ std::string build_command(const std::string& target, const std::string& engine, const std::string& mode,
+                           const std::string& input, int threads, int iterations, int reorder, unsigned long long seed) {
+     std::ostringstream cmd;
+     cmd << "./" << target << " -f " << input << " -i " << iterations << " -s " << seed;
+     if (target != "serial") {
+         cmd << " -n " << threads;
+     }
+     if (target == "parallel") {
+         cmd << " -e " << engine << " -m " << mode;
+         if (reorder > 0) {
+             cmd << " -r " << reorder;
+         }
+     }
+     return cmd.str();
+ }
+
+ void write_csv(std::ostream& out, const std::vector<Result>& results) {
+     out << "target,engine,mode,input,threads,iterations,reorder,runs,init_median,init_stddev,compute_median,compute_stddev\n";
+     out << std::fixed << std::setprecision(6);
+     for (const auto& r : results) {
+         out << r.target << "," << r.engine << "," << r.mode << "," << r.input << "," << r.threads << "," << r.iterations << ","
+             << r.reorder << "," << r.runs << "," << r.init.median << "," << r.init.stddev << ","
+             << r.compute.median << "," << r.compute.stddev << "\n";
+     }
+ }
+
+ void write_json(std::ostream& out, const std::vector<Result>& results) {
+     out << std::fixed << std::setprecision(6);
+     out << "[\n";
+     for (size_t i = 0; i < results.size(); i++) {
+         const auto& r = results[i];
+         out << "  {\"target\": \"" << r.target << "\", \"engine\": \"" << r.engine << "\", \"mode\": \"" << r.mode
+             << "\", \"input\": \"" << r.input << "\", \"threads\": " << r.threads
+             << ", \"iterations\": " << r.iterations << ", \"reorder\": " << r.reorder << ", \"runs\": " << r.runs
+             << ", \"init_median\": " << r.init.median << ", \"init_stddev\": " << r.init.stddev
+             << ", \"compute_median\": " << r.compute.median << ", \"compute_stddev\": " << r.compute.stddev << "}"
+             << (i + 1 < results.size() ? ",\n" : "\n");
+     }
+     out << "]\n";
+ }
+
+ void print_usage(const char *prog) {
+     std::cerr << "Usage: " << prog << " -f input[,input...] [options]\n";
+     std::cerr << "  -t targets     serial,parallel,no_quadtree (default all)\n";
+     std::cerr << "  -e engines     parallel engines (default all)\n";
+     std::cerr << "  -m modes       parallel modes, regions,persistent,tiled,events (default regions)\n";
+     std::cerr << "  -n threads     thread counts (default 1,2,4,8)\n";
+     std::cerr << "  -i iterations  iteration counts (default 100)\n";
+     std::cerr << "  -k steps       parallel reorder intervals, 0 for none (default 0)\n";
+     std::cerr << "  -r repeats     runs per configuration (default 3)\n";
+     std::cerr << "  -s seed        seed passed to every run (default 1)\n";
+     std::cerr << "  -o output      .csv or .json file (default CSV on stdout)\n";
+ }
+
+ int main(int argc, char *argv[]) {
+     std::vector<std::string> inputs;
+     std::vector<std::string> run_targets = targets;
+     std::vector<std::string> run_engines = engines;
+     std::vector<std::string> run_modes = {"regions"};
+     std::vector<int> thread_counts = {1, 2, 4, 8};
+     std::vector<int> iteration_counts = {100};
+     std::vector<int> reorder_intervals = {0};
+     int repeats = 3;
+     unsigned long long seed = 1;
+     std::string output_filename;
+
+     int opt;
+     while ((opt = getopt(argc, argv, "f:t:e:m:n:i:k:r:s:o:")) != -1) {
+         switch (opt) {
+         case 'f':
+             inputs = split_list(optarg);
+             break;
+         case 't':
+             run_targets = split_list(optarg);
+             break;
+         case 'e':
+             run_engines = split_list(optarg);
+             break;
+         case 'm':
+             run_modes = split_list(optarg);
+             break;
+         case 'n':
+             thread_counts = split_ints(optarg);
+             break;
+         case 'i':
+             iteration_counts = split_ints(optarg);
+             break;
+         case 'k':
+             reorder_intervals = split_ints(optarg);
+             break;
+         case 'r':
+             repeats = atoi(optarg);
+             break;
+         case 's':
+             seed = strtoull(optarg, nullptr, 10);
+             break;
+         case 'o':
+             output_filename = optarg;
+             break;
+         default:
+             print_usage(argv[0]);
+             exit(EXIT_FAILURE);
+         }
+     }
+
+     bool valid = !inputs.empty() && repeats > 0 && !thread_counts.empty() && !iteration_counts.empty();
+     for (const auto& t : run_targets) {
+         valid = valid && std::find(targets.begin(), targets.end(), t) != targets.end();
+     }
+     for (const auto& e : run_engines) {
+         valid = valid && std::find(engines.begin(), engines.end(), e) != engines.end();
+     }
+     for (const auto& m : run_modes) {
+         valid = valid && std::find(modes.begin(), modes.end(), m) != modes.end();
+     }
+     for (int v : thread_counts) {
+         valid = valid && v > 0;
+     }
+     for (int v : iteration_counts) {
+         valid = valid && v > 0;
+     }
+     for (int v : reorder_intervals) {
+         valid = valid && v >= 0;
+     }
+     if (!valid) {
+         print_usage(argv[0]);
+         exit(EXIT_FAILURE);
+     }
+
+     std::vector<Result> results;
+     for (const auto& target : run_targets) {
+         // only the parallel binary has engines and modes, and serial ignores threads
+         std::vector<std::string> target_engines = (target == "parallel") ? run_engines : std::vector<std::string>{"-"};
+         std::vector<std::string> target_modes = (target == "parallel") ? run_modes : std::vector<std::string>{"-"};
+         std::vector<int> target_threads = (target == "serial") ? std::vector<int>{1} : thread_counts;
+         std::vector<int> target_reorders = (target == "parallel") ? reorder_intervals : std::vector<int>{0};
+
+         for (const auto& input : inputs) {
+             for (const auto& engine : target_engines) {
+                 for (const auto& mode : target_modes) {
+                     // the persistent mode has no linear, leaves, sort or verlet engine,
+                     // the tiled mode only runs the bitmap engine, the events mode the flagged ones
+                     if (mode == "persistent" && (engine == "linear" || engine == "leaves" || engine == "sort" ||
+                                                  engine == "verlet")) {
+                         continue;
+                     }
+                     if (mode == "tiled" && engine != "bitmap") {
+                         continue;
+                     }
+                     if (mode == "events" && engine != "bitmap" && engine != "sort" && engine != "hash") {
+                         continue;
+                     }
+                     for (int threads : target_threads) {
+                         for (int reorder : target_reorders) {
+                             // only the regions loop reorders
+                             if (reorder > 0 && mode != "regions") {
+                                 continue;
+                             }
+                             for (int iterations : iteration_counts) {
+                                 std::string command = build_command(target, engine, mode, input, threads, iterations, reorder, seed);
+                                 std::cerr << command << "\n";
+
+                                 std::vector<double> init_times, compute_times;
+                                 for (int r = 0; r < repeats; r++) {
+                                     double init_time, compute_time;
+                                     if (run_once(command, init_time, compute_time)) {
+                                         init_times.push_back(init_time);
+                                         compute_times.push_back(compute_time);
+                                     }
+                                 }
+                                 if (init_times.empty()) {
+                                     continue;
+                                 }
+
+                                 Result result;
+                                 result.target = target;
+                                 result.engine = engine;
+                                 result.mode = mode;
+                                 result.input = input;
+                                 result.threads = threads;
+                                 result.iterations = iterations;
+                                 result.reorder = reorder;
+                                 result.runs = (int)init_times.size();
+                                 result.init = summarize(init_times);
+                                 result.compute = summarize(compute_times);
+                                 results.push_back(result);
+                             }
+                         }
+                     }
+                 }
+             }
+         }
+     }
+
+     if (empty(output_filename)) {
+         write_csv(std::cout, results);
+         return 0;
+     }
+
+     std::ofstream fout(output_filename);
+     if (!fout) {
+         std::cerr << "Unable to write file: " << output_filename << ".\n";
+         exit(EXIT_FAILURE);
+     }
+     bool json = output_filename.size() >= 5 && output_filename.compare(output_filename.size() - 5, 5, ".json") == 0;
+     if (json) {
+         write_json(fout, results);
+     }
+     else {
+         write_csv(fout, results);
+     }
+ }
@@ -0,0 +1,77 @@
+/**
+ * Sparse Cell Hash
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #include <iostream>
+
+ #include "cell_hash.h"
+
+ CellHash::CellHash(int max_keys) {
+     int bits = 10;
+     while (bits < 31 && (1ull << bits) < 2 * (uint64_t)max_keys) {
+         bits++;
+     }
+     mask = (1ull << bits) - 1;
+     shift = 64 - bits;
+
+     int n = capacity();
+     keys.reset(new std::atomic<uint64_t>[n]);
+     targets.reset(new std::atomic<int>[n]);
+     occupants.reset(new std::atomic<int>[n]);
+     for (int s = 0; s < n; s++) {
+         keys[s].store(empty_key, std::memory_order_relaxed);
+         targets[s].store(0, std::memory_order_relaxed);
+         occupants[s].store(0, std::memory_order_relaxed);
+     }
+ }
+
+ // Fibonacci hashing: the top bits of the product mix both coordinates, so
+ // rows and columns of neighbouring cells do not pile into the same run.
+ uint64_t CellHash::home(uint64_t key) const {
+     return (key * 0x9E3779B97F4A7C15ull) >> shift;
+ }
+
+ int CellHash::insert(uint64_t key) {
+     uint64_t s = home(key);
+     for (uint64_t probes = 0; probes <= mask; probes++, s = (s + 1) & mask) {
+         uint64_t current = keys[s].load(std::memory_order_relaxed);
+         if (current == key) {
+             return (int)s;
+         }
+         if (current == empty_key) {
+             // on failure current holds the winner's key, which may be ours
+             if (keys[s].compare_exchange_strong(current, key, std::memory_order_relaxed) || current == key) {
+                 return (int)s;
+             }
+         }
+     }
+     std::cerr << "Cell hash is full.\n";
+     exit(EXIT_FAILURE);
+ }
+
+ int CellHash::find(uint64_t key) const {
+     uint64_t s = home(key);
+     for (uint64_t probes = 0; probes <= mask; probes++, s = (s + 1) & mask) {
+         uint64_t current = keys[s].load(std::memory_order_relaxed);
+         if (current == key) {
+             return (int)s;
+         }
+         if (current == empty_key) {
+             return -1;
+         }
+     }
+     return -1;
+ }
+
+ void CellHash::clear_team() {
+     int n = capacity();
+     #pragma omp for schedule(static)
+     for (int s = 0; s < n; s++) {
+         if (keys[s].load(std::memory_order_relaxed) != empty_key) {
+             keys[s].store(empty_key, std::memory_order_relaxed);
+             targets[s].store(0, std::memory_order_relaxed);
+             occupants[s].store(0, std::memory_order_relaxed);
+         }
+     }
+ }
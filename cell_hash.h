@@ -0,0 +1,53 @@
+/**
+ * Sparse Cell Hash (Header file)
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #ifndef CELL_HASH_H
+ #define CELL_HASH_H
+
+ #include <atomic>
+ #include <cstdint>
+ #include <memory>
+
+ // Open-addressing hash table from packed (x, y) cells to per-cell counters,
+ // for grids far too large to give every cell a bit. The table has a fixed
+ // power-of-two number of slots chosen from the number of keys it must hold
+ // at once, so memory follows the agent count and not the grid area. Keys are
+ // claimed with a CAS and linear probing, without locks; nothing is ever
+ // removed one at a time, clear_team() empties every slot and keeps the memory.
+ class CellHash {
+     public:
+         static const uint64_t empty_key = ~0ull;
+
+         // counters of the cell in each slot, zero while the slot is empty
+         std::unique_ptr<std::atomic<int>[]> targets;
+         std::unique_ptr<std::atomic<int>[]> occupants;
+
+         // room for max_keys distinct cells at a load factor of at most 1/2
+         explicit CellHash(int max_keys);
+
+         static uint64_t pack(int x, int y) {
+             return ((uint64_t)(uint32_t)y << 32) | (uint32_t)x;
+         }
+
+         // slot of key, claiming an empty one if the key is not there yet
+         int insert(uint64_t key);
+         // slot of key, or -1
+         int find(uint64_t key) const;
+         // worksharing only, for every thread of an already running team
+         void clear_team();
+
+         int capacity() const {
+             return (int)mask + 1;
+         }
+
+     private:
+         uint64_t mask;
+         int shift;
+         std::unique_ptr<std::atomic<uint64_t>[]> keys;
+
+         uint64_t home(uint64_t key) const;
+ };
+
+ #endif
@@ -0,0 +1,235 @@
+/**
+ * Concurrent Quadtree Structure
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #include <algorithm>
+ #include <atomic>
+ #include <climits>
+ #include <new>
+ #include <thread>
+
+ #include "concurrent_quadtree.h"
+ #include "quadtree.h"
+
+ // slot markers: an agent that was removed, and an agent that was handed down
+ // to the children when its leaf split
+ static Agent tombstone_marker;
+ static Agent moved_marker;
+
+ AgentBucket::AgentBucket() {
+     for (int k = 0; k < bucket_size; k++) {
+         slots[k].store(nullptr);
+     }
+     next.store(nullptr);
+ }
+
+ AgentBucket::~AgentBucket() {
+     delete next.load();
+ }
+
+ ConcurrentQuadtree::ConcurrentQuadtree(int min_x, int min_y, int max_x, int max_y, int depth):
+ min_x(min_x), min_y(min_y), max_x(max_x), max_y(max_y), depth(depth), count(0), children(nullptr) {
+ }
+
+ static ConcurrentQuadtree *make_children(int min_x, int min_y, int max_x, int max_y, int depth) {
+     int midX = (min_x + max_x) / 2;
+     int midY = (min_y + max_y) / 2;
+
+     void *block = ::operator new(4 * sizeof(ConcurrentQuadtree));
+     ConcurrentQuadtree *kids = static_cast<ConcurrentQuadtree*>(block);
+     new (&kids[0]) ConcurrentQuadtree(min_x, min_y, midX, midY, depth + 1);
+     new (&kids[1]) ConcurrentQuadtree(midX, min_y, max_x, midY, depth + 1);
+     new (&kids[2]) ConcurrentQuadtree(min_x, midY, midX, max_y, depth + 1);
+     new (&kids[3]) ConcurrentQuadtree(midX, midY, max_x, max_y, depth + 1);
+     return kids;
+ }
+
+ static void destroy_children(ConcurrentQuadtree *kids) {
+     for (int i = 0; i < 4; i++) {
+         kids[i].~ConcurrentQuadtree();
+     }
+     ::operator delete(kids);
+ }
+
+ ConcurrentQuadtree::~ConcurrentQuadtree() {
+     ConcurrentQuadtree *kids = children.load();
+     if (kids != nullptr) {
+         destroy_children(kids);
+     }
+ }
+
+ bool ConcurrentQuadtree::is_live(const Agent *agent) {
+     return agent != nullptr && agent != &tombstone_marker && agent != &moved_marker;
+ }
+
+ // nodes above max_depth split once they hold more than max_agents
+ int ConcurrentQuadtree::capacity() const {
+     return depth < max_depth ? max_agents : INT_MAX;
+ }
+
+ std::atomic<Agent*> *ConcurrentQuadtree::slot(int k, bool grow) {
+     AgentBucket *b = &bucket;
+     for (int i = 0; i < k / bucket_size; i++) {
+         AgentBucket *next = b->next.load();
+         if (next == nullptr) {
+             if (!grow) {
+                 return nullptr;
+             }
+             AgentBucket *fresh = new AgentBucket();
+             if (b->next.compare_exchange_strong(next, fresh)) {
+                 next = fresh;
+             }
+             else {
+                 delete fresh;
+             }
+         }
+         b = next;
+     }
+     return &b->slots[k % bucket_size];
+ }
+
+ // same overlap margin as Quadtree::getMultiQuadrant, as a bit per quadrant
+ int ConcurrentQuadtree::multi_quadrant(const Agent &agent) const {
+     int midX = (min_x + max_x) / 2;
+     int midY = (min_y + max_y) / 2;
+
+     bool top = agent.y_pos <= midY + 2;
+     bool bottom = agent.y_pos >= midY - 1;
+     bool right = agent.x_pos >= midX - 1;
+     bool left = agent.x_pos <= midX + 2;
+
+     return (top && left) | ((top && right) << 1) | ((bottom && left) << 2) | ((bottom && right) << 3);
+ }
+
+ ConcurrentQuadtree *ConcurrentQuadtree::split() {
+     ConcurrentQuadtree *kids = children.load();
+     if (kids != nullptr) {
+         return kids;
+     }
+
+     ConcurrentQuadtree *fresh = make_children(min_x, min_y, max_x, max_y, depth);
+     if (!children.compare_exchange_strong(kids, fresh)) {
+         // another thread published first, kids now holds its block
+         destroy_children(fresh);
+         return kids;
+     }
+
+     hand_down(fresh);
+     return fresh;
+ }
+
+ // Move the agents of a leaf that just split into its children. An agent is
+ // inserted below before its slot is marked moved, so a concurrent remove()
+ // either tombstones the slot first (and we undo the insert) or finds the
+ // agent in the children.
+ void ConcurrentQuadtree::hand_down(ConcurrentQuadtree *kids) {
+     for (int k = 0; k < capacity(); k++) {
+         std::atomic<Agent*> *s = slot(k, true);
+
+         Agent *a;
+         while ((a = s->load()) == nullptr) {
+             // an append that won slot k has not stored its agent yet
+             std::this_thread::yield();
+         }
+         if (a == &tombstone_marker) {
+             continue;
+         }
+
+         int quads = multi_quadrant(*a);
+         for (int q = 0; q < 4; q++) {
+             if (quads & (1 << q)) {
+                 kids[q].insert(a);
+             }
+         }
+
+         Agent *expected = a;
+         if (!s->compare_exchange_strong(expected, &moved_marker)) {
+             for (int q = 0; q < 4; q++) {
+                 if (quads & (1 << q)) {
+                     kids[q].remove(a);
+                 }
+             }
+         }
+     }
+ }
+
+ void ConcurrentQuadtree::insert(Agent *agent) {
+     ConcurrentQuadtree *kids = children.load();
+
+     if (kids == nullptr) {
+         int k = count.fetch_add(1);
+         if (k < capacity()) {
+             slot(k, true)->store(agent);
+             return;
+         }
+         kids = split();
+     }
+
+     int quads = multi_quadrant(*agent);
+     for (int q = 0; q < 4; q++) {
+         if (quads & (1 << q)) {
+             kids[q].insert(agent);
+         }
+     }
+ }
+
+ void ConcurrentQuadtree::remove(Agent *agent) {
+     int n = std::min(count.load(), capacity());
+     for (int k = 0; k < n; k++) {
+         std::atomic<Agent*> *s = slot(k, false);
+         if (s == nullptr) {
+             break;
+         }
+         Agent *expected = agent;
+         if (s->compare_exchange_strong(expected, &tombstone_marker)) {
+             break;
+         }
+     }
+
+     ConcurrentQuadtree *kids = children.load();
+     if (kids != nullptr) {
+         int quads = multi_quadrant(*agent);
+         for (int q = 0; q < 4; q++) {
+             if (quads & (1 << q)) {
+                 kids[q].remove(agent);
+             }
+         }
+     }
+ }
+
+ void ConcurrentQuadtree::clear() {
+     int n = std::min(count.load(), capacity());
+     for (int k = 0; k < n; k++) {
+         std::atomic<Agent*> *s = slot(k, false);
+         if (s == nullptr) {
+             break;
+         }
+         s->store(nullptr);
+     }
+     count.store(0);
+
+     ConcurrentQuadtree *kids = children.load();
+     if (kids != nullptr) {
+         for (int i = 0; i < 4; i++) {
+             kids[i].clear();
+         }
+     }
+ }
+
+ ConcurrentQuadtree *ConcurrentQuadtree::get_leaf(const Agent &agent) {
+     ConcurrentQuadtree *curr = this;
+     ConcurrentQuadtree *kids;
+
+     while ((kids = curr->children.load()) != nullptr) {
+         int midX = (curr->min_x + curr->max_x) / 2;
+         int midY = (curr->min_y + curr->max_y) / 2;
+
+         bool top = agent.y_pos <= midY;
+         bool left = agent.x_pos <= midX;
+
+         // same tie-breaking as Quadtree::getQuadrant
+         curr = &kids[top ? (left ? 0 : 1) : (left ? 2 : 3)];
+     }
+     return curr;
+ }
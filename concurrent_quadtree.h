@@ -0,0 +1,73 @@
+/**
+ * Concurrent Quadtree Structure (Header file)
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #ifndef CONCURRENT_QUADTREE_H
+ #define CONCURRENT_QUADTREE_H
+
+ #include <algorithm>
+ #include <atomic>
+ #include "agent.h"
+
+ const int bucket_size = 16;
+
+ // Agent slots of a node. Slot k of a node lives in bucket k / bucket_size of
+ // its chain; only max-depth leaves ever need more than the first bucket.
+ struct AgentBucket {
+     std::atomic<Agent*> slots[bucket_size];
+     std::atomic<AgentBucket*> next;
+
+     AgentBucket();
+     ~AgentBucket();
+ };
+
+ // Quadtree without per-node locks. Agents are appended to a leaf with an
+ // atomic fetch_add on its slot counter; a leaf that overflows publishes its
+ // four children with a single CAS and the winner hands the existing agents
+ // down. Removal swaps the agent's slot for a tombstone. Like Quadtree, nodes
+ // never merge, and clear() empties every node without freeing it.
+ class ConcurrentQuadtree {
+     public:
+         int min_x, min_y, max_x, max_y;
+         int depth;
+
+         std::atomic<int> count;
+         AgentBucket bucket;
+         std::atomic<ConcurrentQuadtree*> children; // block of 4, nullptr for a leaf
+
+         ConcurrentQuadtree(int min_x, int min_y, int max_x, int max_y, int depth);
+         ~ConcurrentQuadtree();
+
+         void insert(Agent *agent);
+         void remove(Agent *agent);
+         void clear();
+         ConcurrentQuadtree *get_leaf(const Agent &agent);
+
+         static bool is_live(const Agent *agent);
+
+         // calls f(Agent*) for every agent currently stored in this node
+         template <typename F>
+         void for_each_agent(F f) {
+             int n = std::min(count.load(), capacity());
+             AgentBucket *b = &bucket;
+             for (int k = 0; k < n && b != nullptr; k++) {
+                 Agent *a = b->slots[k % bucket_size].load();
+                 if (is_live(a)) {
+                     f(a);
+                 }
+                 if (k % bucket_size == bucket_size - 1) {
+                     b = b->next.load();
+                 }
+             }
+         }
+
+     private:
+         int capacity() const;
+         std::atomic<Agent*> *slot(int k, bool grow);
+         int multi_quadrant(const Agent &agent) const;
+         ConcurrentQuadtree *split();
+         void hand_down(ConcurrentQuadtree *kids);
+ };
+
+ #endif
@@ -0,0 +1,60 @@
+/**
+ * Scenario Converter
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ *
+ * Converts a text scenario from inputs/ into the binary format read by
+ * load_scenario, e.g. ./convert -f inputs/dense.txt -o inputs/dense.bin
+ */
+
+ #include <iostream>
+ #include <string>
+ #include <vector>
+
+ #include <unistd.h>
+ #include "agent.h"
+ #include "scenario.h"
+
+ int main(int argc, char *argv[]) {
+     std::string input_filename;
+     std::string output_filename;
+
+     int opt;
+     while ((opt = getopt(argc, argv, "f:o:")) != -1) {
+         switch (opt) {
+         case 'f':
+             input_filename = optarg;
+             break;
+         case 'o':
+             output_filename = optarg;
+             break;
+         default:
+             std::cerr << "Usage: " << argv[0] << " -f input_filename -o output_filename\n";
+             exit(EXIT_FAILURE);
+         }
+     }
+
+     if (empty(input_filename) || empty(output_filename)) {
+         std::cerr << "Usage: " << argv[0] << " -f input_filename -o output_filename\n";
+         exit(EXIT_FAILURE);
+     }
+
+     int dim_x, dim_y;
+     std::vector<Agent> agents;
+     if (!load_scenario(input_filename, dim_x, dim_y, agents)) {
+         std::cerr << "Unable to open file: " << input_filename << ".\n";
+         exit(EXIT_FAILURE);
+     }
+
+     std::vector<int> xs(agents.size()), ys(agents.size()), dirs(agents.size());
+     for (size_t i = 0; i < agents.size(); i++) {
+         xs[i] = agents[i].x_pos;
+         ys[i] = agents[i].y_pos;
+         dirs[i] = agents[i].dir;
+     }
+
+     if (!write_scenario_binary(output_filename, dim_x, dim_y, xs, ys, dirs)) {
+         std::cerr << "Unable to write file: " << output_filename << ".\n";
+         exit(EXIT_FAILURE);
+     }
+     std::cout << "Wrote " << agents.size() << " agents (" << dim_x << "x" << dim_y << ") to " << output_filename << "\n";
+ }
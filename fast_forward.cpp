@@ -0,0 +1,214 @@
+/**
+ * Event-Driven Fast-Forward
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #include <algorithm>
+ #include <cstdlib>
+
+ #include "fast_forward.h"
+ #include "grid.h"
+
+ // The moving coordinate c in [0, d) and the one that stays put. Unfolding
+ // the walk onto a cycle of period 2(d - 1), phase u runs c up to d - 1 and
+ // back down: c = u on the way up, c = period - u on the way back.
+ struct FreeAxis {
+     int c, d;
+     int fixed, fixed_d;
+     bool up;
+
+     FreeAxis(const Agent& agent, int dim_x, int dim_y) {
+         bool horizontal = (agent.dir == 1 || agent.dir == 3);
+         c = horizontal ? agent.x_pos : agent.y_pos;
+         d = horizontal ? dim_x : dim_y;
+         fixed = horizontal ? agent.y_pos : agent.x_pos;
+         fixed_d = horizontal ? dim_y : dim_x;
+         up = (agent.dir == 1 || agent.dir == 2);
+     }
+
+     long long period() const {
+         return 2 * (long long)(d - 1);
+     }
+
+     // an agent at the far edge still heading up turns around on its next
+     // move, which is where the way back starts, so it keeps phase c
+     long long phase() const {
+         return up ? c : (period() - c) % period();
+     }
+ };
+
+ bool free_motion_predictable(const Agent& agent, int dim_x, int dim_y) {
+     if (agent.dir < 0 || agent.dir > 3) {
+         return false;
+     }
+     return FreeAxis(agent, dim_x, dim_y).d >= 2;
+ }
+
+ // only an agent walking along an edge ever reaches a corner, at the phases
+ // where the moving coordinate is 0 or d - 1
+ int free_steps_to_corner(const Agent& agent, int dim_x, int dim_y) {
+     FreeAxis axis(agent, dim_x, dim_y);
+     if (axis.fixed != 0 && axis.fixed != axis.fixed_d - 1) {
+         return -1;
+     }
+
+     long long p = axis.period();
+     long long u = axis.phase();
+     long long to_low = (p - u) % p;
+     long long to_high = ((axis.d - 1 - u) % p + p) % p;
+     return (int)std::min(to_low, to_high);
+ }
+
+ void free_advance(Agent& agent, int steps, int dim_x, int dim_y) {
+     if (steps <= 0) {
+         return;
+     }
+
+     FreeAxis axis(agent, dim_x, dim_y);
+     long long p = axis.period();
+     long long u = (axis.phase() + steps) % p;
+     int c = (int)(u <= axis.d - 1 ? u : p - u);
+     // the direction of the last move, up from phases 0 .. d - 2
+     bool went_up = (u + p - 1) % p <= axis.d - 2;
+
+     if (agent.dir == 1 || agent.dir == 3) {
+         agent.x_pos = c;
+         agent.dir = went_up ? 1 : 3;
+     }
+     else {
+         agent.y_pos = c;
+         agent.dir = went_up ? 2 : 0;
+     }
+     agent.next_x = agent.x_pos;
+     agent.next_y = agent.y_pos;
+ }
+
+ // blocks no smaller than the grid engine's cells, so the block array stays
+ // within a few entries per agent however large the grid is
+ FastForward::FastForward(int dim_x, int dim_y, const std::vector<Agent>& agents):
+ sleeps(0), dim_x(dim_x), dim_y(dim_y) {
+     int num_agents = (int)agents.size();
+     block_size = std::max((int)min_block_size, Grid::suggest_cell_size(dim_x, dim_y, num_agents));
+     blocks_x = (dim_x + block_size - 1) / block_size;
+     blocks_y = (dim_y + block_size - 1) / block_size;
+     blocks.resize((size_t)blocks_x * blocks_y);
+     wake.assign(num_agents, 0);
+     asleep_from.assign(num_agents, 0);
+     pos_x.assign(num_agents, 0);
+     pos_y.assign(num_agents, 0);
+     block_of.assign(num_agents, -1);
+     slot.assign(num_agents, -1);
+     for (int i = 0; i < num_agents; i++) {
+         place(i, agents[i].x_pos, agents[i].y_pos);
+     }
+ }
+
+ int FastForward::block_index(int x, int y) const {
+     return (y / block_size) * blocks_x + (x / block_size);
+ }
+
+ void FastForward::place(int i, int x, int y) {
+     pos_x[i] = x;
+     pos_y[i] = y;
+     int block = block_index(x, y);
+     if (block == block_of[i]) {
+         return;
+     }
+
+     if (block_of[i] != -1) {
+         std::vector<int>& old = blocks[block_of[i]];
+         int last = old.back();
+         old[slot[i]] = last;
+         slot[last] = slot[i];
+         old.pop_back();
+     }
+     std::vector<int>& members = blocks[block];
+     slot[i] = (int)members.size();
+     members.push_back(i);
+     block_of[i] = block;
+ }
+
+ void FastForward::moved(int i, const Agent& agent) {
+     place(i, agent.x_pos, agent.y_pos);
+ }
+
+ // Scans rings of blocks outwards from the agent's own. Everybody in ring r
+ // is more than (r - 1) * block_size cells away, so the scan stops once that
+ // distance alone allows the sleep found so far; in a crowd the first ring
+ // already turns the agent down.
+ int FastForward::wake_step(const Agent& agent, int i, int t) const {
+     if (!free_motion_predictable(agent, dim_x, dim_y)) {
+         return t;
+     }
+     int corner = free_steps_to_corner(agent, dim_x, dim_y);
+     if (corner == 0) {
+         return t;
+     }
+
+     long long limit = (long long)t + max_sleep;
+     if (corner > 0) {
+         limit = std::min(limit, (long long)t + corner);
+     }
+
+     int bx = agent.x_pos / block_size;
+     int by = agent.y_pos / block_size;
+     for (int r = 0; ; r++) {
+         if (r > 0 && (long long)t + ((long long)(r - 1) * block_size) / 2 >= limit) {
+             break;
+         }
+         for (int y = by - r; y <= by + r; y++) {
+             if (y < 0 || y >= blocks_y) {
+                 continue;
+             }
+             // the full rows at the top and bottom of the ring, only the two
+             // end blocks in between
+             int step = (y == by - r || y == by + r) ? 1 : std::max(2 * r, 1);
+             for (int x = bx - r; x <= bx + r; x += step) {
+                 if (x < 0 || x >= blocks_x) {
+                     continue;
+                 }
+                 for (int k : blocks[(size_t)y * blocks_x + x]) {
+                     if (k == i) {
+                         continue;
+                     }
+                     long long e = std::max(wake[k], t);
+                     long long dist = std::abs(agent.x_pos - pos_x[k]) + std::abs(agent.y_pos - pos_y[k]);
+                     long long v = dist - 2 + t + e;
+                     long long first = (v <= 0) ? e : std::max(e, (v + 1) / 2);
+                     limit = std::min(limit, first);
+                     if (limit < (long long)t + min_sleep) {
+                         return t;
+                     }
+                 }
+             }
+         }
+     }
+     return (int)limit;
+ }
+
+ void FastForward::sleep(const Agent& agent, int i, int t, int wake_at) {
+     Agent later = agent;
+     free_advance(later, wake_at - t, dim_x, dim_y);
+     place(i, later.x_pos, later.y_pos);
+     wake[i] = wake_at;
+     asleep_from[i] = t;
+     queue.push({wake_at, i});
+     sleeps++;
+ }
+
+ void FastForward::wake_due(std::vector<Agent>& agents, int t, std::vector<int>& awake) {
+     while (!queue.empty() && queue.top().first <= t) {
+         int i = queue.top().second;
+         queue.pop();
+         free_advance(agents[i], t - asleep_from[i], dim_x, dim_y);
+         awake.push_back(i);
+     }
+ }
+
+ void FastForward::finish(std::vector<Agent>& agents, int t) {
+     while (!queue.empty()) {
+         int i = queue.top().second;
+         queue.pop();
+         free_advance(agents[i], t - asleep_from[i], dim_x, dim_y);
+     }
+ }
@@ -0,0 +1,75 @@
+/**
+ * Event-Driven Fast-Forward (Header file)
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #ifndef FAST_FORWARD_H
+ #define FAST_FORWARD_H
+
+ #include <functional>
+ #include <queue>
+ #include <utility>
+ #include <vector>
+ #include "agent.h"
+
+ // What move_agent does to an agent that meets nobody: it walks along one
+ // axis and turns around at the edges, so its position is periodic and can be
+ // computed for any step. Only corners need the coin, and an agent at a corner
+ // is never advanced this way.
+ bool free_motion_predictable(const Agent& agent, int dim_x, int dim_y);
+ // steps until the agent stands on a corner, 0 if it does now, -1 if never
+ int free_steps_to_corner(const Agent& agent, int dim_x, int dim_y);
+ // the agent after steps collision-free moves, no corner on the way
+ void free_advance(Agent& agent, int steps, int dim_x, int dim_y);
+
+ // Wake-up bookkeeping for agents that are left alone while they cannot meet
+ // anybody. Every agent k has a wake step and a position at that step: for an
+ // agent being stepped these are the current step and position, for a
+ // sleeping agent the step it will be stepped again and where its free motion
+ // puts it then. Agents move at most one cell per step and only agents within
+ // two cells (Manhattan) of each other can conflict, so an agent at p on step
+ // t cannot meet k before max(e_k, ceil((|p - q_k| - 2 + t + e_k) / 2)). The
+ // wake positions are indexed in square blocks of about one agent each,
+ // searched outwards from the agent until nobody further out could cut its
+ // sleep short.
+ class FastForward {
+     public:
+         // longest single sleep and the shortest one worth the queue traffic
+         static const int max_sleep = 64;
+         static const int min_sleep = 8;
+         static const int min_block_size = 16;
+
+         long long sleeps = 0;
+
+         FastForward(int dim_x, int dim_y, const std::vector<Agent>& agents);
+
+         // record where an agent being stepped stands now
+         void moved(int i, const Agent& agent);
+         // first step at which the agent, standing where it is at step t,
+         // has to be stepped again; read-only, safe from any thread
+         int wake_step(const Agent& agent, int i, int t) const;
+         // leave the agent, whose state is for step t, alone until wake
+         void sleep(const Agent& agent, int i, int t, int wake);
+         // brings every agent due at step t up to date and appends it to awake
+         void wake_due(std::vector<Agent>& agents, int t, std::vector<int>& awake);
+         // brings every sleeping agent up to date at step t
+         void finish(std::vector<Agent>& agents, int t);
+
+     private:
+         int dim_x, dim_y;
+         int block_size;
+         int blocks_x, blocks_y;
+
+         std::vector<int> wake;
+         std::vector<int> asleep_from;
+         std::vector<int> pos_x, pos_y;
+         std::vector<int> block_of;
+         std::vector<int> slot;
+         std::vector<std::vector<int>> blocks;
+         std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> queue;
+
+         int block_index(int x, int y) const;
+         void place(int i, int x, int y);
+ };
+
+ #endif
@@ -0,0 +1,293 @@
+/**
+ * Scenario Generator
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ *
+ * Writes a synthetic scenario with a chosen grid size, agent count and start
+ * distribution, e.g.
+ *     ./generate -x 16384 -y 16384 -n 1000000 -d clusters -o big.bin -b
+ * Every draw comes from counter_rng keyed on (seed, agent, attempt), so the
+ * same flags give the same file at any thread count.
+ */
+
+ #include <algorithm>
+ #include <charconv>
+ #include <cmath>
+ #include <cstdint>
+ #include <fstream>
+ #include <iostream>
+ #include <string>
+ #include <vector>
+
+ #include <unistd.h>
+ #include <omp.h>
+ #include "radix_sort.h"
+ #include "rng.h"
+ #include "scenario.h"
+
+ const std::vector<std::string> distributions = {"uniform", "clusters", "corridors", "bottleneck"};
+
+ // after this many rejected draws an agent falls back to a uniform draw, so a
+ // distribution that is packed tighter than its shape allows still finishes
+ const int fallback_attempts = 32;
+
+ // agents formatted per text block before it is written out
+ const int text_block = 1 << 16;
+
+ struct Generator {
+     int dim_x, dim_y;
+     int distribution;
+     int groups;
+     uint64_t seed;
+     std::vector<double> center_x, center_y;
+     double sigma;
+     int lane_width;
+     int gap;
+
+     Generator(int dim_x, int dim_y, int distribution, int groups, uint64_t seed);
+     void sample(int agent_id, int attempt, int& x, int& y, int& dir) const;
+ };
+
+ // uniform double in [0, 1)
+ static double unit(uint64_t r) {
+     return (double)(r >> 11) * (1.0 / 9007199254740992.0);
+ }
+
+ static uint64_t draw(uint64_t seed, int agent_id, int attempt, int k) {
+     return counter_rng(seed, (uint32_t)agent_id, (uint32_t)(attempt * 4 + k));
+ }
+
+ Generator::Generator(int dim_x, int dim_y, int distribution, int groups, uint64_t seed)
+     : dim_x(dim_x), dim_y(dim_y), distribution(distribution), groups(groups), seed(seed) {
+     // cluster centres use their own stream so they do not depend on agent draws
+     uint64_t center_seed = splitmix64(seed ^ 0x636C75737465ull);
+     center_x.resize(groups);
+     center_y.resize(groups);
+     for (int c = 0; c < groups; c++) {
+         center_x[c] = unit(counter_rng(center_seed, c, 0)) * dim_x;
+         center_y[c] = unit(counter_rng(center_seed, c, 1)) * dim_y;
+     }
+     sigma = std::max(1.0, std::min(dim_x, dim_y) / (4.0 * std::sqrt((double)groups)));
+
+     // corridors cover about a quarter of the rows
+     lane_width = std::max(1, dim_y / (4 * groups));
+     gap = std::max(1, dim_y / 16);
+ }
+
+ void Generator::sample(int agent_id, int attempt, int& x, int& y, int& dir) const {
+     uint64_t r0 = draw(seed, agent_id, attempt, 0);
+     uint64_t r1 = draw(seed, agent_id, attempt, 1);
+     uint64_t r2 = draw(seed, agent_id, attempt, 2);
+     uint64_t r3 = draw(seed, agent_id, attempt, 3);
+
+     if (distribution == 0 || attempt >= fallback_attempts) {
+         x = (int)(r0 % dim_x);
+         y = (int)(r1 % dim_y);
+         dir = (int)(r2 % 5);
+         return;
+     }
+
+     if (distribution == 1) {
+         // Box-Muller around a randomly chosen centre
+         int c = (int)(r0 % groups);
+         double u1 = 1.0 - unit(r1);
+         double u2 = unit(r2);
+         double radius = sigma * std::sqrt(-2.0 * std::log(u1));
+         double px = center_x[c] + radius * std::cos(2.0 * M_PI * u2);
+         double py = center_y[c] + radius * std::sin(2.0 * M_PI * u2);
+         if (px < 0 || py < 0 || px >= dim_x || py >= dim_y) {
+             // off the grid, redraw uniformly instead of piling up on the edge
+             x = (int)(r1 % dim_x);
+             y = (int)(r2 % dim_y);
+         }
+         else {
+             x = (int)px;
+             y = (int)py;
+         }
+         dir = (int)(r3 % 5);
+     }
+     else if (distribution == 2) {
+         // evenly spaced horizontal lanes, half heading east and half west
+         int lane = (int)(r0 % groups);
+         int lane_center = (int)(((int64_t)2 * lane + 1) * dim_y / (2 * groups));
+         y = std::min(dim_y - 1, std::max(0, lane_center - lane_width / 2 + (int)(r1 % lane_width)));
+         x = (int)(r2 % dim_x);
+         dir = (r3 >> 63) ? 1 : 3;
+     }
+     else {
+         // funnel towards a gap in the middle column; the band of rows an
+         // agent may start in narrows to the gap as it nears the centre
+         double mid = 0.5 * dim_x;
+         double px = unit(r0) * dim_x;
+         double half = 0.5 * gap + (0.5 * dim_y - 0.5 * gap) * std::abs(px - mid) / mid;
+         double py = 0.5 * dim_y + (2.0 * unit(r1) - 1.0) * half;
+         x = std::min(dim_x - 1, (int)px);
+         y = std::min(dim_y - 1, std::max(0, (int)py));
+         dir = (x < mid) ? 1 : 3;
+     }
+ }
+
+ static int key_bits_for(uint64_t area) {
+     int bits = 1;
+     while (bits < 64 && (area - 1) >> bits) {
+         bits++;
+     }
+     return bits;
+ }
+
+ // Redraws agents that start on an already taken cell until every start
+ // position is unique. The stable sort keeps the lowest agent id of each
+ // cell, so which agents get redrawn does not depend on the thread count.
+ void remove_duplicates(const Generator& gen, int num_agents, std::vector<int>& xs, std::vector<int>& ys, std::vector<int>& dirs) {
+     std::vector<int> attempts(num_agents, 0);
+     std::vector<char> redraw(num_agents, 0);
+     std::vector<uint64_t> keys(num_agents);
+     std::vector<int> order(num_agents);
+     int key_bits = key_bits_for((uint64_t)gen.dim_x * gen.dim_y);
+
+     while (true) {
+         #pragma omp parallel for schedule(static)
+         for (int i = 0; i < num_agents; i++) {
+             keys[i] = (uint64_t)ys[i] * gen.dim_x + xs[i];
+             order[i] = i;
+         }
+         radix_sort_pairs(keys, order, key_bits);
+
+         int duplicates = 0;
+         #pragma omp parallel for schedule(static) reduction(+:duplicates)
+         for (int j = 1; j < num_agents; j++) {
+             if (keys[j] == keys[j-1]) {
+                 redraw[order[j]] = 1;
+                 duplicates++;
+             }
+         }
+         if (duplicates == 0) {
+             break;
+         }
+
+         #pragma omp parallel for schedule(static)
+         for (int i = 0; i < num_agents; i++) {
+             if (redraw[i]) {
+                 redraw[i] = 0;
+                 attempts[i]++;
+                 gen.sample(i, attempts[i], xs[i], ys[i], dirs[i]);
+             }
+         }
+     }
+ }
+
+ // Formats blocks of agents in parallel and writes them in order, so the text
+ // never has to sit in memory all at once.
+ bool write_scenario_text(const std::string& filename, int dim_x, int dim_y,
+                          const std::vector<int>& xs, const std::vector<int>& ys, const std::vector<int>& dirs) {
+     std::ofstream fout(filename, std::ios::binary);
+     if (!fout) {
+         return false;
+     }
+     int num_agents = (int)xs.size();
+     fout << dim_x << " " << dim_y << "\n" << num_agents << "\n";
+
+     int num_threads = omp_get_max_threads();
+     std::vector<std::string> blocks(num_threads);
+     int round = text_block * num_threads;
+
+     for (int base = 0; base < num_agents; base += round) {
+         #pragma omp parallel for schedule(static, 1)
+         for (int b = 0; b < num_threads; b++) {
+             std::string& out = blocks[b];
+             out.clear();
+             int begin = std::min(num_agents, base + b * text_block);
+             int end = std::min(num_agents, begin + text_block);
+             char line[40];
+             for (int i = begin; i < end; i++) {
+                 char *p = line;
+                 p = std::to_chars(p, line + sizeof(line), xs[i]).ptr;
+                 *p++ = ' ';
+                 p = std::to_chars(p, line + sizeof(line), ys[i]).ptr;
+                 *p++ = ' ';
+                 p = std::to_chars(p, line + sizeof(line), dirs[i]).ptr;
+                 *p++ = '\n';
+                 out.append(line, p - line);
+             }
+         }
+         for (int b = 0; b < num_threads; b++) {
+             fout.write(blocks[b].data(), blocks[b].size());
+         }
+     }
+     return (bool)fout;
+ }
+
+ void print_usage(const char *prog) {
+     std::cerr << "Usage: " << prog << " -x dim_x -y dim_y -n num_agents -o output_filename"
+               << " [-d uniform|clusters|corridors|bottleneck] [-c groups] [-s seed] [-b]\n";
+ }
+
+ int main(int argc, char *argv[]) {
+     std::string output_filename;
+     int dim_x = 0, dim_y = 0;
+     long long num_agents = -1;
+     std::string distribution = "uniform";
+     int groups = 8;
+     uint64_t seed = 0;
+     bool binary = false;
+
+     int opt;
+     while ((opt = getopt(argc, argv, "x:y:n:o:d:c:s:b")) != -1) {
+         switch (opt) {
+         case 'x':
+             dim_x = atoi(optarg);
+             break;
+         case 'y':
+             dim_y = atoi(optarg);
+             break;
+         case 'n':
+             num_agents = atoll(optarg);
+             break;
+         case 'o':
+             output_filename = optarg;
+             break;
+         case 'd':
+             distribution = optarg;
+             break;
+         case 'c':
+             groups = atoi(optarg);
+             break;
+         case 's':
+             seed = strtoull(optarg, nullptr, 10);
+             break;
+         case 'b':
+             binary = true;
+             break;
+         default:
+             print_usage(argv[0]);
+             exit(EXIT_FAILURE);
+         }
+     }
+
+     auto it = std::find(distributions.begin(), distributions.end(), distribution);
+     if (empty(output_filename) || dim_x <= 0 || dim_y <= 0 || num_agents < 0 || groups <= 0 || it == distributions.end()) {
+         print_usage(argv[0]);
+         exit(EXIT_FAILURE);
+     }
+     if (num_agents > (long long)dim_x * dim_y || num_agents > INT32_MAX) {
+         std::cerr << "Cannot place " << num_agents << " agents on a " << dim_x << "x" << dim_y << " grid.\n";
+         exit(EXIT_FAILURE);
+     }
+
+     int n = (int)num_agents;
+     Generator gen(dim_x, dim_y, (int)(it - distributions.begin()), groups, seed);
+     std::vector<int> xs(n), ys(n), dirs(n);
+
+     #pragma omp parallel for schedule(static)
+     for (int i = 0; i < n; i++) {
+         gen.sample(i, 0, xs[i], ys[i], dirs[i]);
+     }
+     remove_duplicates(gen, n, xs, ys, dirs);
+
+     bool ok = binary ? write_scenario_binary(output_filename, dim_x, dim_y, xs, ys, dirs)
+                      : write_scenario_text(output_filename, dim_x, dim_y, xs, ys, dirs);
+     if (!ok) {
+         std::cerr << "Unable to write file: " << output_filename << ".\n";
+         exit(EXIT_FAILURE);
+     }
+     std::cout << "Wrote " << n << " " << distribution << " agents (" << dim_x << "x" << dim_y << ") to " << output_filename << "\n";
+ }
@@ -0,0 +1,106 @@
+/**
+ * Uniform Grid Structure
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #include <algorithm>
+ #include <cmath>
+ #include <vector>
+
+ #include <omp.h>
+ #include "grid.h"
+
+ Grid::Grid(int dim_x, int dim_y, int cell_size):
+ dim_x(dim_x), dim_y(dim_y), cell_size(std::max(cell_size, 1)) {
+     cells_x = (dim_x + this->cell_size - 1) / this->cell_size;
+     cells_y = (dim_y + this->cell_size - 1) / this->cell_size;
+     cell_start.assign((size_t)cells_x * cells_y + 1, 0);
+     cursor.assign((size_t)cells_x * cells_y, 0);
+ }
+
+ // aim for about one agent per cell so the index stays O(num_agents) in size
+ int Grid::suggest_cell_size(int dim_x, int dim_y, int num_agents) {
+     if (num_agents <= 0) {
+         return std::max(dim_x, dim_y);
+     }
+     double area_per_agent = (double)dim_x * dim_y / num_agents;
+     return std::max(1, (int)std::ceil(std::sqrt(area_per_agent)));
+ }
+
+ int Grid::cell_of(int x, int y) const {
+     return (y / cell_size) * cells_x + (x / cell_size);
+ }
+
+ // Worksharing only, so it runs on whichever team calls it: build() opens a
+ // region for it, build_team() joins the caller's.
+ template <typename NextCell>
+ void Grid::build_cells(int num_agents, NextCell next_cell) {
+     int num_cells = cells_x * cells_y;
+     #pragma omp single
+     {
+         agent_cell.resize(num_agents);
+         cell_agents.resize(num_agents);
+     }
+
+     #pragma omp for
+     for (int c = 0; c < num_cells; c++) {
+         cursor[c] = 0;
+     }
+
+     // count agents per cell
+     #pragma omp for
+     for (int i = 0; i < num_agents; i++) {
+         int c = next_cell(i);
+         agent_cell[i] = c;
+
+         #pragma omp atomic
+         cursor[c]++;
+     }
+
+     // exclusive prefix sum gives the start of every cell
+     #pragma omp single
+     {
+         int sum = 0;
+         for (int c = 0; c < num_cells; c++) {
+             cell_start[c] = sum;
+             sum += cursor[c];
+             cursor[c] = cell_start[c];
+         }
+         cell_start[num_cells] = sum;
+     }
+
+     // scatter agent indices into their cells
+     #pragma omp for
+     for (int i = 0; i < num_agents; i++) {
+         int slot;
+         #pragma omp atomic capture
+         slot = cursor[agent_cell[i]]++;
+
+         cell_agents[slot] = i;
+     }
+ }
+
+ void Grid::build(const std::vector<Agent>& agents, int num_agents) {
+     #pragma omp parallel
+     build_team(agents, num_agents);
+ }
+
+ void Grid::build(const AgentSoA& soa, int num_agents) {
+     #pragma omp parallel
+     build_cells(num_agents, [&](int i) {
+         return cell_of(soa.next_x[i], soa.next_y[i]);
+     });
+ }
+
+ void Grid::build_team(const std::vector<Agent>& agents, int num_agents) {
+     build_cells(num_agents, [&](int i) {
+         return cell_of(agents[i].next_x, agents[i].next_y);
+     });
+ }
+
+ void Grid::build_positions(const std::vector<Agent>& agents, int num_agents) {
+     #pragma omp parallel
+     build_cells(num_agents, [&](int i) {
+         return cell_of(agents[i].x_pos, agents[i].y_pos);
+     });
+ }
@@ -0,0 +1,45 @@
+/**
+ * Uniform Grid Structure (Header file)
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #ifndef GRID_H
+ #define GRID_H
+
+ #include <vector>
+ #include "agent.h"
+ #include "agent_soa.h"
+
+ // Flat spatial index over the agents' next positions (or the current ones,
+ // with build_positions). The grid is split into square cells of cell_size x
+ // cell_size and rebuilt every step with a counting sort, so the agents of
+ // cell c are cell_agents[cell_start[c] .. cell_start[c+1]).
+ class Grid {
+     public:
+         int dim_x, dim_y;
+         int cell_size;
+         int cells_x, cells_y;
+
+         std::vector<int> cell_start;
+         std::vector<int> cell_agents;
+
+         Grid(int dim_x, int dim_y, int cell_size);
+
+         static int suggest_cell_size(int dim_x, int dim_y, int num_agents);
+         int cell_of(int x, int y) const;
+         void build(const std::vector<Agent>& agents, int num_agents);
+         void build(const AgentSoA& soa, int num_agents);
+         // same as build(agents), for every thread of an already running team
+         void build_team(const std::vector<Agent>& agents, int num_agents);
+         // same as build(agents), but over the current positions
+         void build_positions(const std::vector<Agent>& agents, int num_agents);
+
+     private:
+         template <typename NextCell>
+         void build_cells(int num_agents, NextCell next_cell);
+
+         std::vector<int> agent_cell;
+         std::vector<int> cursor;
+ };
+
+ #endif
@@ -0,0 +1,145 @@
+/**
+ * Agent Leaf Set (Header file)
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #ifndef LEAF_SET_H
+ #define LEAF_SET_H
+
+ #include <algorithm>
+ #include <climits>
+ #include <memory>
+ #include <vector>
+
+ // Ids of the quadtree leaves one agent is stored in. The 3x3 margin of an
+ // agent reaches at most two leaves per axis while leaves are at least four
+ // cells wide, so four ids are kept inline and a set never allocates. Deeper
+ // trees on small grids can put an agent in more leaves; only those agents
+ // get an overflow vector, which is kept across clear() to avoid reallocating.
+ // Ids are unordered and comparisons ignore order.
+ //
+ // A set can also carry a box of positions that walk down the tree exactly
+ // like the one it was looked up for, and so land in the same leaves. An
+ // agent still inside its box can skip the walk. Removing ids drops the box,
+ // which is how a split of one of the leaves invalidates it.
+ class LeafSet {
+     public:
+         static const int inline_capacity = 4;
+
+         int size() const {
+             return count;
+         }
+
+         int at(int k) const {
+             return k < inline_capacity ? ids[k] : (*overflow)[k - inline_capacity];
+         }
+
+         void add(int id) {
+             if (count < inline_capacity) {
+                 ids[count] = id;
+             }
+             else {
+                 if (!overflow) {
+                     overflow.reset(new std::vector<int>());
+                 }
+                 overflow->push_back(id);
+             }
+             count++;
+         }
+
+         // drops every copy of id; the last id fills the hole
+         void remove(int id) {
+             drop_box();
+             int k = 0;
+             while (k < count) {
+                 if (at(k) == id) {
+                     slot(k) = at(count - 1);
+                     pop_back();
+                 }
+                 else {
+                     k++;
+                 }
+             }
+         }
+
+         void clear() {
+             drop_box();
+             count = 0;
+             if (overflow) {
+                 overflow->clear();
+             }
+         }
+
+         bool contains(int id) const {
+             for (int k = 0; k < count; k++) {
+                 if (at(k) == id) {
+                     return true;
+                 }
+             }
+             return false;
+         }
+
+         // same ids, in any order
+         bool same_leaves(const LeafSet& other) const {
+             for (int k = 0; k < count; k++) {
+                 if (!other.contains(at(k))) {
+                     return false;
+                 }
+             }
+             for (int k = 0; k < other.count; k++) {
+                 if (!contains(other.at(k))) {
+                     return false;
+                 }
+             }
+             return true;
+         }
+
+         // a walk starts from an unbounded box and narrows it at every node
+         void open_box() {
+             box_min_x = box_min_y = INT_MIN;
+             box_max_x = box_max_y = INT_MAX;
+         }
+
+         void clip_box(int min_x, int min_y, int max_x, int max_y) {
+             box_min_x = std::max(box_min_x, min_x);
+             box_min_y = std::max(box_min_y, min_y);
+             box_max_x = std::min(box_max_x, max_x);
+             box_max_y = std::min(box_max_y, max_y);
+         }
+
+         void copy_box(const LeafSet& other) {
+             box_min_x = other.box_min_x;
+             box_min_y = other.box_min_y;
+             box_max_x = other.box_max_x;
+             box_max_y = other.box_max_y;
+         }
+
+         void drop_box() {
+             box_min_x = box_min_y = 1;
+             box_max_x = box_max_y = 0;
+         }
+
+         bool box_covers(int x, int y) const {
+             return x >= box_min_x && x <= box_max_x && y >= box_min_y && y <= box_max_y;
+         }
+
+     private:
+         int count = 0;
+         int ids[inline_capacity];
+         std::unique_ptr<std::vector<int>> overflow;
+         // empty until a walk fills it in
+         int box_min_x = 1, box_min_y = 1, box_max_x = 0, box_max_y = 0;
+
+         int& slot(int k) {
+             return k < inline_capacity ? ids[k] : (*overflow)[k - inline_capacity];
+         }
+
+         void pop_back() {
+             count--;
+             if (count >= inline_capacity) {
+                 overflow->pop_back();
+             }
+         }
+ };
+
+ #endif
@@ -0,0 +1,147 @@
+/**
+ * Linear Quadtree Structure
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #include <algorithm>
+ #include <cstdint>
+ #include <vector>
+
+ #include <omp.h>
+ #include "linear_quadtree.h"
+ #include "quadtree.h"
+ #include "radix_sort.h"
+
+ // tasks below this many agents are built by the thread that found them
+ const int task_cutoff = 4096;
+
+ static uint32_t spread_bits(uint32_t v) {
+     v &= 0x0000FFFF;
+     v = (v | (v << 8)) & 0x00FF00FF;
+     v = (v | (v << 4)) & 0x0F0F0F0F;
+     v = (v | (v << 2)) & 0x33333333;
+     v = (v | (v << 1)) & 0x55555555;
+     return v;
+ }
+
+ static uint32_t compact_bits(uint32_t v) {
+     v &= 0x55555555;
+     v = (v | (v >> 1)) & 0x33333333;
+     v = (v | (v >> 2)) & 0x0F0F0F0F;
+     v = (v | (v >> 4)) & 0x00FF00FF;
+     v = (v | (v >> 8)) & 0x0000FFFF;
+     return v;
+ }
+
+ uint32_t morton_code(int x, int y) {
+     return spread_bits((uint32_t)x) | (spread_bits((uint32_t)y) << 1);
+ }
+
+ static uint64_t spread_bits64(uint64_t v) {
+     v &= 0x00000000FFFFFFFFull;
+     v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+     v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+     v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+     v = (v | (v << 2)) & 0x3333333333333333ull;
+     v = (v | (v << 1)) & 0x5555555555555555ull;
+     return v;
+ }
+
+ uint64_t morton_code64(int x, int y) {
+     return spread_bits64((uint32_t)x) | (spread_bits64((uint32_t)y) << 1);
+ }
+
+ LinearQuadtree::LinearQuadtree(int dim_x, int dim_y): dim_x(dim_x), dim_y(dim_y) {
+     bits = 0;
+     while ((1 << bits) < std::max(dim_x, dim_y)) {
+         bits++;
+     }
+ }
+
+ void LinearQuadtree::build(const std::vector<Agent>& agents, int num_agents) {
+     keys.resize(num_agents);
+     order.resize(num_agents);
+
+     #pragma omp parallel for
+     for (int i = 0; i < num_agents; i++) {
+         keys[i] = morton_code(agents[i].next_x, agents[i].next_y);
+         order[i] = i;
+     }
+
+     radix_sort_pairs(keys, order, 2 * bits);
+
+     thread_leaves.resize(omp_get_max_threads());
+     for (auto& local : thread_leaves) {
+         local.clear();
+     }
+
+     #pragma omp parallel
+     #pragma omp single
+     build_node(0, 0, 0, num_agents);
+
+     leaves.clear();
+     for (auto& local : thread_leaves) {
+         leaves.insert(leaves.end(), local.begin(), local.end());
+     }
+     std::sort(leaves.begin(), leaves.end(), [](const Leaf& a, const Leaf& b) {
+         return a.code_lo < b.code_lo;
+     });
+ }
+
+ // a node is a leaf once it holds at most max_agents or reaches max_depth,
+ // the same rule multiInsert uses to decide when to split
+ void LinearQuadtree::build_node(int depth, uint32_t prefix, int begin, int end) {
+     if (begin == end) {
+         return;
+     }
+
+     int shift = 2 * (bits - depth);
+     if (end - begin <= max_agents || depth >= max_depth || depth >= bits) {
+         Leaf leaf;
+         leaf.code_lo = (uint32_t)((uint64_t)prefix << shift);
+         leaf.code_hi = (uint32_t)(((uint64_t)prefix << shift) + (1ull << shift) - 1);
+         leaf.begin = begin;
+         leaf.end = end;
+         leaf.min_x = (int)compact_bits(leaf.code_lo);
+         leaf.min_y = (int)compact_bits(leaf.code_lo >> 1);
+         leaf.size = 1 << (bits - depth);
+
+         thread_leaves[omp_get_thread_num()].push_back(leaf);
+         return;
+     }
+
+     int child_shift = shift - 2;
+     int child_begin = begin;
+     for (uint32_t quad = 0; quad < 4; quad++) {
+         uint32_t child_prefix = (prefix << 2) | quad;
+         uint32_t child_hi = (uint32_t)((((uint64_t)child_prefix + 1) << child_shift) - 1);
+         int child_end = (int)(std::upper_bound(keys.begin() + child_begin, keys.begin() + end, child_hi) - keys.begin());
+
+         if (child_end - child_begin > task_cutoff) {
+             #pragma omp task firstprivate(child_prefix, child_begin, child_end)
+             build_node(depth + 1, child_prefix, child_begin, child_end);
+         }
+         else {
+             build_node(depth + 1, child_prefix, child_begin, child_end);
+         }
+         child_begin = child_end;
+     }
+     #pragma omp taskwait
+ }
+
+ const LinearQuadtree::Leaf *LinearQuadtree::get_leaf(int x, int y) const {
+     uint32_t code = morton_code(x, y);
+
+     auto it = std::upper_bound(leaves.begin(), leaves.end(), code, [](uint32_t c, const Leaf& leaf) {
+         return c < leaf.code_lo;
+     });
+     if (it == leaves.begin()) {
+         return nullptr;
+     }
+     --it;
+     return code <= it->code_hi ? &*it : nullptr;
+ }
+
+ const LinearQuadtree::Leaf *LinearQuadtree::get_leaf(const Agent &agent) const {
+     return get_leaf(agent.next_x, agent.next_y);
+ }
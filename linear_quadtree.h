@@ -0,0 +1,48 @@
+/**
+ * Linear Quadtree Structure (Header file)
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #ifndef LINEAR_QUADTREE_H
+ #define LINEAR_QUADTREE_H
+
+ #include <cstdint>
+ #include <vector>
+ #include "agent.h"
+
+ uint32_t morton_code(int x, int y);
+ // same interleaving for coordinates up to 2^31, on grids past 65536 cells
+ uint64_t morton_code64(int x, int y);
+
+ // Quadtree stored as a flat array of leaves, rebuilt from scratch every step.
+ // Agents are sorted by the Morton code of their next position, so every node
+ // of the tree is a contiguous range of the sorted array and a leaf only needs
+ // to remember that range. Empty regions have no leaf.
+ class LinearQuadtree {
+     public:
+         struct Leaf {
+             uint32_t code_lo, code_hi;
+             int begin, end;         // range in order[]
+             int min_x, min_y, size; // bounds of the node
+         };
+
+         int dim_x, dim_y;
+         int bits;                   // the tree covers a 2^bits x 2^bits square
+
+         std::vector<uint32_t> keys; // sorted Morton codes
+         std::vector<int> order;     // agent index of every sorted key
+         std::vector<Leaf> leaves;   // ordered by code
+
+         LinearQuadtree(int dim_x, int dim_y);
+
+         void build(const std::vector<Agent>& agents, int num_agents);
+         const Leaf *get_leaf(int x, int y) const;
+         const Leaf *get_leaf(const Agent &agent) const;
+
+     private:
+         std::vector<std::vector<Leaf>> thread_leaves;
+
+         void build_node(int depth, uint32_t prefix, int begin, int end);
+ };
+
+ #endif
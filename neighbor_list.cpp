@@ -0,0 +1,93 @@
+/**
+ * Verlet Neighbor Lists
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #include <algorithm>
+ #include <climits>
+ #include <cstdlib>
+ #include <iostream>
+
+ #include <omp.h>
+ #include "neighbor_list.h"
+
+ // cells of the grid are at least radius wide, so the square around an agent
+ // spans at most three of them per axis, and no smaller than the grid engine
+ // would pick, so sparse worlds do not pay for millions of empty cells
+ NeighborList::NeighborList(int dim_x, int dim_y, int num_agents, int reuse_steps):
+ reuse_steps(reuse_steps), radius(2 * reuse_steps + 1),
+ grid(dim_x, dim_y, std::max(2 * reuse_steps + 1, Grid::suggest_cell_size(dim_x, dim_y, num_agents))), age(reuse_steps) {
+ }
+
+ void NeighborList::refresh(const std::vector<Agent>& agents, int num_agents) {
+     if (age >= reuse_steps) {
+         build(agents, num_agents);
+         age = 0;
+     }
+     age++;
+ }
+
+ // calls visit(j) for every other agent within radius of agent i
+ template <typename Visit>
+ static void for_each_near(const Grid& grid, const std::vector<Agent>& agents, int i, int radius, Visit visit) {
+     int x = agents[i].x_pos;
+     int y = agents[i].y_pos;
+     int min_cx = std::max(x - radius, 0) / grid.cell_size;
+     int max_cx = std::min(x + radius, grid.dim_x - 1) / grid.cell_size;
+     int min_cy = std::max(y - radius, 0) / grid.cell_size;
+     int max_cy = std::min(y + radius, grid.dim_y - 1) / grid.cell_size;
+
+     for (int cy = min_cy; cy <= max_cy; cy++) {
+         for (int cx = min_cx; cx <= max_cx; cx++) {
+             int c = cy * grid.cells_x + cx;
+             for (int k = grid.cell_start[c]; k < grid.cell_start[c + 1]; k++) {
+                 int j = grid.cell_agents[k];
+                 if (j != i && std::abs(agents[j].x_pos - x) <= radius && std::abs(agents[j].y_pos - y) <= radius) {
+                     visit(j);
+                 }
+             }
+         }
+     }
+ }
+
+ // count every list, lay them out with a prefix sum, then fill them in
+ void NeighborList::build(const std::vector<Agent>& agents, int num_agents) {
+     grid.build_positions(agents, num_agents);
+     neighbor_start.resize(num_agents + 1);
+     rebuilds++;
+
+     #pragma omp parallel
+     {
+         #pragma omp for schedule(dynamic, 64)
+         for (int i = 0; i < num_agents; i++) {
+             int count = 0;
+             for_each_near(grid, agents, i, radius, [&](int) {
+                 count++;
+             });
+             neighbor_start[i + 1] = count;
+         }
+
+         #pragma omp single
+         {
+             long long total = 0;
+             neighbor_start[0] = 0;
+             for (int i = 0; i < num_agents; i++) {
+                 total += neighbor_start[i + 1];
+                 if (total > INT_MAX) {
+                     std::cerr << "Neighbor lists are too large, use fewer reuse steps.\n";
+                     exit(EXIT_FAILURE);
+                 }
+                 neighbor_start[i + 1] = (int)total;
+             }
+             neighbors.resize(total);
+         }
+
+         #pragma omp for schedule(dynamic, 64)
+         for (int i = 0; i < num_agents; i++) {
+             int next = neighbor_start[i];
+             for_each_near(grid, agents, i, radius, [&](int j) {
+                 neighbors[next++] = j;
+             });
+         }
+     }
+ }
@@ -0,0 +1,46 @@
+/**
+ * Verlet Neighbor Lists (Header file)
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #ifndef NEIGHBOR_LIST_H
+ #define NEIGHBOR_LIST_H
+
+ #include <vector>
+ #include "agent.h"
+ #include "grid.h"
+
+ // Cached collision candidates, reused for several steps. An agent moves at
+ // most one cell per step, so two agents that collide within reuse_steps
+ // steps of a build start at most 2 * reuse_steps cells apart (Chebyshev)
+ // and lists of every agent within radius = 2 * reuse_steps + 1 cells of it
+ // stay complete until the next build. The lists are stored flat: the
+ // candidates of agent i are neighbors[neighbor_start[i] .. neighbor_start[i+1]).
+ class NeighborList {
+     public:
+         int reuse_steps;
+         int radius;
+         int rebuilds = 0;
+
+         std::vector<int> neighbor_start;
+         std::vector<int> neighbors;
+
+         NeighborList(int dim_x, int dim_y, int num_agents, int reuse_steps);
+
+         // call once per step, before the agents' current positions change;
+         // rebuilds the lists after reuse_steps steps
+         void refresh(const std::vector<Agent>& agents, int num_agents);
+         // forces a rebuild on the next refresh, e.g. once the agents have
+         // been renumbered
+         void invalidate() {
+             age = reuse_steps;
+         }
+
+     private:
+         Grid grid;
+         int age;
+
+         void build(const std::vector<Agent>& agents, int num_agents);
+ };
+
+ #endif
@@ -10,7 +10,6 @@
  #include <chrono>
  #include <string>
  #include <vector>
- #include <unordered_set>
 
     
  #include <random>
@@ -18,13 +17,31 @@
  #include <cstdlib>
  #include <ctime>
  #include <climits>
+ #include <cstdint>
+ #include <tuple>
     
  #include <unistd.h>
  #include "quadtree.h"
+ #include "grid.h"
+ #include "agent_soa.h"
+ #include "linear_quadtree.h"
+ #include "concurrent_quadtree.h"
+ #include "cell_hash.h"
+ #include "neighbor_list.h"
+ #include "active_set.h"
+ #include "fast_forward.h"
+ #include "radix_sort.h"
+ #include "rng.h"
+ #include "scenario.h"
+ #include "profile.h"
+ #include "step_kernels.h"
+ #include "split_tuner.h"
 
  #include <omp.h>
- /* Uncomment the following line to use the simulation
- #include <SDL2/SDL.h>  */
+ // build with make VISUALIZE=1 to use the simulation
+ #ifdef VISUALIZE
+ #include <SDL2/SDL.h>
+ #endif
  
  const int WINDOW_WIDTH = 800;
  const int WINDOW_HEIGHT = 800;
@@ -44,202 +61,1501 @@
      return true;
  }
  
- void resolve_collisions(std::vector<int> colliders, std::vector<Agent>& agents, int num_agents, int dimX, int dimY) {
-     #pragma omp parallel for schedule(dynamic)
+ // turn the agent around; it stays put if that would take it off the grid
+ void bounce_agent(Agent &agent, int dimX, int dimY) {
+     if(agent.dir == 0){ 
+         agent.dir = 2;
+         agent.next_y = agent.y_pos + 1; 
+
+         if(agent.next_y > dimY -1 || agent.next_y < 0){
+             agent.next_y = agent.y_pos;
+         }
+     }
+     else if(agent.dir == 1){
+         agent.dir = 3;
+         agent.next_x = agent.x_pos - 1;
+
+         if(agent.next_x > dimX -1 || agent.next_x < 0){
+             agent.next_x = agent.x_pos;
+         }
+     }
+     else if(agent.dir == 2){
+         agent.dir = 0;
+         agent.next_y = agent.y_pos - 1;
+         if(agent.next_y > dimY -1 || agent.next_y < 0){
+             agent.next_y = agent.y_pos;
+         }
+     }
+     else{
+         agent.dir = 1;
+         agent.next_x = agent.x_pos + 1;
+         if(agent.next_x > dimX -1 || agent.next_x < 0){
+             agent.next_x = agent.x_pos;
+         }
+     }
+ }
+
+ // The *_team functions hold the worksharing loops of one phase and must be
+ // called by every thread of an enclosing parallel region, which has to sync
+ // before the next phase reads their results. The plain versions open a region
+ // of their own around them.
+ void resolve_collisions_team(const std::vector<int>& colliders, std::vector<Agent>& agents, int num_agents, int dimX, int dimY) {
+     PROFILE_THREAD_BEGIN();
+     #pragma omp for schedule(dynamic) nowait
      for (int i = 0; i < num_agents; i++) {
          int collider_id = colliders[i];
          if (collider_id != -1 && collider_id > i) {
-             
-             if(agents[i].dir == 0){ 
-                 agents[i].dir = 2;
-                 agents[i].next_y = agents[i].y_pos + 1; 
- 
-                 if(agents[i].next_y > dimY -1 || agents[i].next_y < 0){
-                     agents[i].next_y = agents[i].y_pos;
+             bounce_agent(agents[i], dimX, dimY);
+             bounce_agent(agents[collider_id], dimX, dimY);
+         }
+     }
+     PROFILE_THREAD_END(phase_resolve);
+ }
+
+ void resolve_collisions(const std::vector<int>& colliders, std::vector<Agent>& agents, int num_agents, int dimX, int dimY) {
+     #pragma omp parallel
+     resolve_collisions_team(colliders, agents, num_agents, dimX, dimY);
+ }
+
+ // every agent that is part of a conflict bounces exactly once; each agent
+ // only writes itself, so the result does not depend on thread timing
+ void resolve_conflicts_team(const std::vector<char>& in_conflict, std::vector<Agent>& agents, int num_agents, int dimX, int dimY) {
+     PROFILE_THREAD_BEGIN();
+     #pragma omp for schedule(static) nowait
+     for (int i = 0; i < num_agents; i++) {
+         if (in_conflict[i]) {
+             bounce_agent(agents[i], dimX, dimY);
+         }
+     }
+     PROFILE_THREAD_END(phase_resolve);
+ }
+
+ void resolve_conflicts(const std::vector<char>& in_conflict, std::vector<Agent>& agents, int num_agents, int dimX, int dimY) {
+     #pragma omp parallel
+     resolve_conflicts_team(in_conflict, agents, num_agents, dimX, dimY);
+ }
+
+
+
+// keeps the lowest-id collider like the grid and leaves engines; the order of
+// a leaf's agents depends on how the inserts interleaved, the lowest id does not
+static void find_collider(std::vector<int>& colliders, std::vector<Agent>& agents, int i, Quadtree* qt) {
+    Quadtree* leaf = qt->get_leaf(agents[i]);
+    std::vector<Agent*> collidable_agents = leaf->collidable_agents();
+
+    int collider = -1;
+    for (const auto& possible_collider : collidable_agents) {
+        if (possible_collider->id != agents[i].id &&
+            (collider == -1 || possible_collider->id < collider) &&
+            ((agents[i].next_x == possible_collider->next_x &&
+            agents[i].next_y == possible_collider->next_y) || 
+            (agents[i].x_pos == possible_collider->next_x &&
+            agents[i].y_pos == possible_collider->next_y))) {
+            collider = possible_collider->id;
+        }
+    }
+    colliders[i] = collider;
+}
+
+void detect_collisions_team(std::vector<int>& colliders, std::vector<Agent>& agents, int num_agents, Quadtree* qt) {
+    PROFILE_THREAD_BEGIN();
+    #pragma omp for schedule(dynamic) nowait
+    for (int i = 0; i < num_agents; i++) {
+        find_collider(colliders, agents, i, qt);
+    }
+    PROFILE_THREAD_END(phase_detect);
+}
+
+void detect_collisions(std::vector<int>& colliders, std::vector<Agent>& agents, int num_agents, Quadtree* qt) {
+    #pragma omp parallel
+    detect_collisions_team(colliders, agents, num_agents, qt);
+}
+
+ // Same as detect_collisions, over the agents of the active set only; every
+ // other agent has nobody within two cells and keeps colliders[i] = -1.
+ void detect_collisions_active(std::vector<int>& colliders, std::vector<Agent>& agents, const std::vector<int>& active, Quadtree* qt) {
+     int num_active = (int)active.size();
+     #pragma omp parallel
+     {
+         PROFILE_THREAD_BEGIN();
+         #pragma omp for schedule(dynamic) nowait
+         for (int k = 0; k < num_active; k++) {
+             find_collider(colliders, agents, active[k], qt);
+         }
+         PROFILE_THREAD_END(phase_detect);
+     }
+ }
+
+ // The leaves of the pointer quadtree that hold at least two agents, in walk
+ // order, each with its agents sorted by id and without repeats, and for every
+ // agent the leaf its own position falls in. Agents near a split line are in
+ // several leaves, so a pair can meet more than once; it is only tested in
+ // the home leaf of its lower-id agent, which holds everyone close enough to
+ // collide with that agent, like the leaf find_collider scans.
+ struct LeafIndex {
+     std::vector<Quadtree*> leaves;
+     std::vector<std::vector<Agent*>> members;
+     std::vector<Quadtree*> home;
+
+     void collect(Quadtree *node) {
+         if (node->is_leaf()) {
+             if (node->agents.size() > 1) {
+                 leaves.push_back(node);
+             }
+             return;
+         }
+         for (int i = 0; i < 4; i++) {
+             collect(node->child(i));
+         }
+     }
+
+     void build(Quadtree *qt, std::vector<Agent>& agents, int num_agents) {
+         leaves.clear();
+         collect(qt);
+         int num_leaves = (int)leaves.size();
+         if ((int)members.size() < num_leaves) {
+             members.resize(num_leaves);
+         }
+         home.resize(num_agents);
+
+         #pragma omp parallel
+         {
+             #pragma omp for schedule(dynamic) nowait
+             for (int k = 0; k < num_leaves; k++) {
+                 std::vector<Agent*>& list = members[k];
+                 list.assign(leaves[k]->agents.begin(), leaves[k]->agents.end());
+                 std::sort(list.begin(), list.end(), [](const Agent *a, const Agent *b) {
+                     return a->id < b->id;
+                 });
+                 list.erase(std::unique(list.begin(), list.end()), list.end());
+             }
+
+             #pragma omp for schedule(static) nowait
+             for (int a = 0; a < num_agents; a++) {
+                 home[a] = qt->get_leaf(agents[a]);
+             }
+         }
+     }
+ };
+
+ // Leaf-parallel detection: one task per leaf tests every pair inside it,
+ // instead of every agent walking down from the root and copying its leaf's
+ // agent list. Each agent keeps its lowest-id collider, so the result does
+ // not depend on which task finds a pair first.
+ void detect_collisions_leaves(std::vector<int>& colliders, std::vector<Agent>& agents, int num_agents, Quadtree* qt, LeafIndex& index) {
+     index.build(qt, agents, num_agents);
+     int num_leaves = (int)index.leaves.size();
+
+     #pragma omp parallel for schedule(static)
+     for (int i = 0; i < num_agents; i++) {
+         colliders[i] = INT_MAX;
+     }
+
+     #pragma omp parallel
+     #pragma omp single
+     for (int k = 0; k < num_leaves; k++) {
+         #pragma omp task firstprivate(k)
+         {
+             const Quadtree *leaf = index.leaves[k];
+             const std::vector<Agent*>& members = index.members[k];
+             int size = (int)members.size();
+
+             // members are in id order, so a is the lower id of every pair
+             for (int p = 0; p < size; p++) {
+                 const Agent *a = members[p];
+                 if (index.home[a->id] != leaf) {
+                     continue;
+                 }
+                 for (int q = p + 1; q < size; q++) {
+                     const Agent *b = members[q];
+                     bool same_target = a->next_x == b->next_x && a->next_y == b->next_y;
+                     bool a_hits_b = same_target || (a->x_pos == b->next_x && a->y_pos == b->next_y);
+                     bool b_hits_a = same_target || (b->x_pos == a->next_x && b->y_pos == a->next_y);
+
+                     if (a_hits_b) {
+                         #pragma omp atomic compare
+                         if (b->id < colliders[a->id]) { colliders[a->id] = b->id; }
+                     }
+                     if (b_hits_a) {
+                         #pragma omp atomic compare
+                         if (a->id < colliders[b->id]) { colliders[b->id] = a->id; }
+                     }
                  }
              }
-             else if(agents[i].dir == 1){
-                 agents[i].dir = 3;
-                 agents[i].next_x = agents[i].x_pos - 1;
+         }
+     }
+
+     #pragma omp parallel for schedule(static)
+     for (int i = 0; i < num_agents; i++) {
+         if (colliders[i] == INT_MAX) {
+             colliders[i] = -1;
+         }
+     }
+ }
+
+// candidates come from the cells overlapping the 3x3 block around next, since
+// any agent that can collide with agents[i] ends up within one cell of it
+void detect_collisions_grid_team(std::vector<int>& colliders, std::vector<Agent>& agents, int num_agents, Grid* grid) {
+    PROFILE_THREAD_BEGIN();
+    #pragma omp for schedule(dynamic, 64) nowait
+    for (int i = 0; i < num_agents; i++) {
+        int min_cx = std::max(agents[i].next_x - 1, 0) / grid->cell_size;
+        int max_cx = std::min(agents[i].next_x + 1, grid->dim_x - 1) / grid->cell_size;
+        int min_cy = std::max(agents[i].next_y - 1, 0) / grid->cell_size;
+        int max_cy = std::min(agents[i].next_y + 1, grid->dim_y - 1) / grid->cell_size;
+
+        int collider = -1;
+        for (int cy = min_cy; cy <= max_cy; cy++) {
+            for (int cx = min_cx; cx <= max_cx; cx++) {
+                int c = cy * grid->cells_x + cx;
+
+                for (int k = grid->cell_start[c]; k < grid->cell_start[c + 1]; k++) {
+                    int j = grid->cell_agents[k];
+                    if (j != i && (collider == -1 || j < collider) &&
+                        ((agents[i].next_x == agents[j].next_x &&
+                        agents[i].next_y == agents[j].next_y) ||
+                        (agents[i].x_pos == agents[j].next_x &&
+                        agents[i].y_pos == agents[j].next_y))) {
+                        collider = j;
+                    }
+                }
+            }
+        }
+        colliders[i] = collider;
+    }
+    PROFILE_THREAD_END(phase_detect);
+}
+
+void detect_collisions_grid(std::vector<int>& colliders, std::vector<Agent>& agents, int num_agents, Grid* grid) {
+    #pragma omp parallel
+    detect_collisions_grid_team(colliders, agents, num_agents, grid);
+}
+
+// same rule and tie-break as the grid engine, over the cached candidates
+void detect_collisions_verlet(std::vector<int>& colliders, std::vector<Agent>& agents, int num_agents, const NeighborList* list) {
+    #pragma omp parallel
+    {
+        PROFILE_THREAD_BEGIN();
+        #pragma omp for schedule(dynamic, 64) nowait
+        for (int i = 0; i < num_agents; i++) {
+            int collider = -1;
+            for (int k = list->neighbor_start[i]; k < list->neighbor_start[i + 1]; k++) {
+                int j = list->neighbors[k];
+                if ((collider == -1 || j < collider) &&
+                    ((agents[i].next_x == agents[j].next_x &&
+                    agents[i].next_y == agents[j].next_y) ||
+                    (agents[i].x_pos == agents[j].next_x &&
+                    agents[i].y_pos == agents[j].next_y))) {
+                    collider = j;
+                }
+            }
+            colliders[i] = collider;
+        }
+        PROFILE_THREAD_END(phase_detect);
+    }
+}
+
+// Runs the grid engine's per-step detection on the same agents and stops the
+// run at the first agent whose collider differs, which would mean a list
+// missed a candidate.
+void check_verlet_colliders(const std::vector<int>& colliders, std::vector<Agent>& agents, int num_agents, Grid* grid,
+                            int step) {
+    std::vector<int> expected(num_agents, -1);
+    grid->build(agents, num_agents);
+    detect_collisions_grid(expected, agents, num_agents, grid);
+
+    for (int i = 0; i < num_agents; i++) {
+        if (colliders[i] != expected[i]) {
+            std::cerr << "Neighbor list check failed at step " << step << ": agent " << i << " has collider "
+                      << colliders[i] << ", expected " << expected[i] << ".\n";
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void detect_collisions_grid_soa(std::vector<int>& colliders, const AgentSoA& soa, int num_agents, Grid* grid) {
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < num_agents; i++) {
+        int next_x = soa.next_x[i], next_y = soa.next_y[i];
+        int x = soa.x[i], y = soa.y[i];
+
+        int min_cx = std::max(next_x - 1, 0) / grid->cell_size;
+        int max_cx = std::min(next_x + 1, grid->dim_x - 1) / grid->cell_size;
+        int min_cy = std::max(next_y - 1, 0) / grid->cell_size;
+        int max_cy = std::min(next_y + 1, grid->dim_y - 1) / grid->cell_size;
+
+        int collider = -1;
+        for (int cy = min_cy; cy <= max_cy; cy++) {
+            for (int cx = min_cx; cx <= max_cx; cx++) {
+                int c = cy * grid->cells_x + cx;
+
+                for (int k = grid->cell_start[c]; k < grid->cell_start[c + 1]; k++) {
+                    int j = grid->cell_agents[k];
+                    if (j != i && (collider == -1 || j < collider) &&
+                        ((next_x == soa.next_x[j] && next_y == soa.next_y[j]) ||
+                        (x == soa.next_x[j] && y == soa.next_y[j]))) {
+                        collider = j;
+                    }
+                }
+            }
+        }
+        colliders[i] = collider;
+    }
+}
+
+// the 3x3 block around next can straddle up to four leaves (more when leaves
+// are smaller than 3 cells), each scanned once
+void detect_collisions_linear(std::vector<int>& colliders, std::vector<Agent>& agents, int num_agents, LinearQuadtree* lqt) {
+    #pragma omp parallel
+    {
+        PROFILE_THREAD_BEGIN();
+        #pragma omp for schedule(dynamic, 64) nowait
+        for (int i = 0; i < num_agents; i++) {
+            const LinearQuadtree::Leaf *found[9];
+            int num_found = 0;
+
+            for (int y = std::max(agents[i].next_y - 1, 0); y <= std::min(agents[i].next_y + 1, lqt->dim_y - 1); y++) {
+                for (int x = std::max(agents[i].next_x - 1, 0); x <= std::min(agents[i].next_x + 1, lqt->dim_x - 1); x++) {
+                    bool covered = false;
+                    for (int k = 0; k < num_found; k++) {
+                        if (x >= found[k]->min_x && x < found[k]->min_x + found[k]->size &&
+                            y >= found[k]->min_y && y < found[k]->min_y + found[k]->size) {
+                            covered = true;
+                            break;
+                        }
+                    }
+                    if (covered) {
+                        continue;
+                    }
+
+                    const LinearQuadtree::Leaf *leaf = lqt->get_leaf(x, y);
+                    if (leaf != nullptr) {
+                        found[num_found++] = leaf;
+                    }
+                }
+            }
+
+            int collider = -1;
+            for (int k = 0; k < num_found; k++) {
+                for (int s = found[k]->begin; s < found[k]->end; s++) {
+                    int j = lqt->order[s];
+                    if (j != i && (collider == -1 || j < collider) &&
+                        ((agents[i].next_x == agents[j].next_x &&
+                        agents[i].next_y == agents[j].next_y) ||
+                        (agents[i].x_pos == agents[j].next_x &&
+                        agents[i].y_pos == agents[j].next_y))) {
+                        collider = j;
+                    }
+                }
+            }
+            colliders[i] = collider;
+        }
+        PROFILE_THREAD_END(phase_detect);
+    }
+}
+
+void detect_collisions_concurrent_team(std::vector<int>& colliders, std::vector<Agent>& agents, int num_agents, ConcurrentQuadtree* cqt) {
+    PROFILE_THREAD_BEGIN();
+    #pragma omp for schedule(dynamic) nowait
+    for (int i = 0; i < num_agents; i++) {
+        ConcurrentQuadtree* leaf = cqt->get_leaf(agents[i]);
+
+        int collider = -1;
+        leaf->for_each_agent([&](Agent *possible_collider) {
+            if (possible_collider->id != agents[i].id &&
+                (collider == -1 || possible_collider->id < collider) &&
+                ((agents[i].next_x == possible_collider->next_x &&
+                agents[i].next_y == possible_collider->next_y) ||
+                (agents[i].x_pos == possible_collider->next_x &&
+                agents[i].y_pos == possible_collider->next_y))) {
+                collider = possible_collider->id;
+            }
+        });
+        colliders[i] = collider;
+    }
+    PROFILE_THREAD_END(phase_detect);
+}
+
+void detect_collisions_concurrent(std::vector<int>& colliders, std::vector<Agent>& agents, int num_agents, ConcurrentQuadtree* cqt) {
+    #pragma omp parallel
+    detect_collisions_concurrent_team(colliders, agents, num_agents, cqt);
+}
+
+ // the concurrent tree is emptied and refilled every step; its nodes stay
+ // allocated, so only the leaf slots are touched
+ void update_concurrent_quadtree_team(std::vector<Agent>& agents, int num_agents, ConcurrentQuadtree *cqt) {
+     #pragma omp single
+     cqt->clear();
+
+     PROFILE_THREAD_BEGIN();
+     #pragma omp for schedule(dynamic, 64) nowait
+     for (int i = 0; i < num_agents; i++) {
+         cqt->insert(&agents[i]);
+     }
+     PROFILE_THREAD_END(phase_refresh);
+ }
+
+ void update_concurrent_quadtree(std::vector<Agent>& agents, int num_agents, ConcurrentQuadtree *cqt) {
+     #pragma omp parallel
+     update_concurrent_quadtree_team(agents, num_agents, cqt);
+ }
+
+ // One bit per cell and layer for bounded grids: target marks cells some agent
+ // moves to, contested cells two or more agents move to, occupied the cells
+ // agents stand on now. 8192x8192 needs 8 MB per layer.
+ struct OccupancyBitmap {
+     int dim_x, dim_y;
+     std::vector<uint64_t> target, contested, occupied;
+
+     OccupancyBitmap(int dim_x, int dim_y): dim_x(dim_x), dim_y(dim_y) {
+         size_t words = ((size_t)dim_x * dim_y + 63) / 64;
+         target.assign(words, 0);
+         contested.assign(words, 0);
+         occupied.assign(words, 0);
+     }
+
+     size_t cell(int x, int y) const {
+         return (size_t)y * dim_x + x;
+     }
+
+     bool test(const std::vector<uint64_t>& layer, size_t c) const {
+         return (layer[c >> 6] >> (c & 63)) & 1;
+     }
+ };
+
+ // An agent is in conflict when another agent targets the same cell, targets
+ // the cell it stands on (the swap case), or stands on the cell it targets.
+ // Bits are set with one atomic fetch-or per agent and only the words touched
+ // this step are cleared afterwards.
+ void detect_collisions_bitmap_team(std::vector<char>& in_conflict, std::vector<Agent>& agents, int num_agents, OccupancyBitmap* bitmap) {
+     #pragma omp for schedule(static)
+     for (int i = 0; i < num_agents; i++) {
+         size_t next = bitmap->cell(agents[i].next_x, agents[i].next_y);
+         uint64_t mask = 1ull << (next & 63);
+         uint64_t old;
+
+         #pragma omp atomic capture
+         { old = bitmap->target[next >> 6]; bitmap->target[next >> 6] |= mask; }
+
+         if (old & mask) {
+             #pragma omp atomic
+             bitmap->contested[next >> 6] |= mask;
+         }
+
+         size_t curr = bitmap->cell(agents[i].x_pos, agents[i].y_pos);
+         #pragma omp atomic
+         bitmap->occupied[curr >> 6] |= 1ull << (curr & 63);
+     }
+
+     #pragma omp for schedule(static)
+     for (int i = 0; i < num_agents; i++) {
+         size_t next = bitmap->cell(agents[i].next_x, agents[i].next_y);
+         size_t curr = bitmap->cell(agents[i].x_pos, agents[i].y_pos);
+
+         bool conflict = bitmap->test(bitmap->contested, next);
+         if (next != curr) {
+             conflict = conflict || bitmap->test(bitmap->target, curr) || bitmap->test(bitmap->occupied, next);
+         }
+         in_conflict[i] = conflict;
+     }
+
+     #pragma omp for schedule(static)
+     for (int i = 0; i < num_agents; i++) {
+         size_t next = bitmap->cell(agents[i].next_x, agents[i].next_y) >> 6;
+         size_t curr = bitmap->cell(agents[i].x_pos, agents[i].y_pos) >> 6;
+
+         bitmap->target[next] = 0;
+         bitmap->contested[next] = 0;
+         bitmap->occupied[curr] = 0;
+     }
+ }
+
+ void detect_collisions_bitmap(std::vector<char>& in_conflict, std::vector<Agent>& agents, int num_agents, OccupancyBitmap* bitmap) {
+     #pragma omp parallel
+     detect_collisions_bitmap_team(in_conflict, agents, num_agents, bitmap);
+ }
+
+ // The bitmap engine's conflict rule with the per-cell state kept in a hash
+ // table, for grids whose area is far beyond the agent count. Each agent
+ // claims the slots of its target and current cells, then reads the counters
+ // back once every agent has been counted.
+ void detect_collisions_hash_team(std::vector<char>& in_conflict, std::vector<Agent>& agents, int num_agents, CellHash* hash) {
+     #pragma omp for schedule(static)
+     for (int i = 0; i < num_agents; i++) {
+         int next = hash->insert(CellHash::pack(agents[i].next_x, agents[i].next_y));
+         hash->targets[next].fetch_add(1, std::memory_order_relaxed);
+
+         int curr = hash->insert(CellHash::pack(agents[i].x_pos, agents[i].y_pos));
+         hash->occupants[curr].store(1, std::memory_order_relaxed);
+     }
+
+     #pragma omp for schedule(static)
+     for (int i = 0; i < num_agents; i++) {
+         int next = hash->find(CellHash::pack(agents[i].next_x, agents[i].next_y));
+         int curr = hash->find(CellHash::pack(agents[i].x_pos, agents[i].y_pos));
+
+         bool conflict = hash->targets[next].load(std::memory_order_relaxed) > 1;
+         if (next != curr) {
+             conflict = conflict || hash->targets[curr].load(std::memory_order_relaxed) > 0 ||
+                        hash->occupants[next].load(std::memory_order_relaxed) > 0;
+         }
+         in_conflict[i] = conflict;
+     }
+
+     hash->clear_team();
+ }
+
+ void detect_collisions_hash(std::vector<char>& in_conflict, std::vector<Agent>& agents, int num_agents, CellHash* hash) {
+     #pragma omp parallel
+     detect_collisions_hash_team(in_conflict, agents, num_agents, hash);
+ }
+
+ // Every agent contributes two records, one for the cell it targets and one
+ // for the cell it stands on, keyed cell * 2 + kind so that after the sort
+ // each cell's records are contiguous.
+ struct CellSort {
+     int dim_x, dim_y;
+     int key_bits;
+     std::vector<uint64_t> keys;
+     std::vector<int> values;
+
+     static const uint64_t target_record = 0;
+     static const uint64_t position_record = 1;
+
+     CellSort(int dim_x, int dim_y): dim_x(dim_x), dim_y(dim_y), key_bits(1) {
+         uint64_t max_key = ((uint64_t)dim_x * dim_y - 1) * 2 + 1;
+         while (max_key >> key_bits) {
+             key_bits++;
+         }
+     }
+
+     uint64_t key(int x, int y, uint64_t kind) const {
+         return ((uint64_t)y * dim_x + x) * 2 + kind;
+     }
+ };
+
+ // Same conflict rule as the bitmap engine, but from a radix sort of the
+ // records instead of a bit per cell, so memory is O(num_agents) for any grid.
+ // The first record of every cell scans the cell's group once; however many
+ // agents pile onto a cell, all of them are flagged and none wins a race.
+ void detect_collisions_sort(std::vector<char>& in_conflict, std::vector<Agent>& agents, int num_agents, CellSort* cells) {
+     cells->keys.resize(2 * (size_t)num_agents);
+     cells->values.resize(2 * (size_t)num_agents);
+
+     #pragma omp parallel for schedule(static)
+     for (int i = 0; i < num_agents; i++) {
+         cells->keys[2 * i] = cells->key(agents[i].next_x, agents[i].next_y, CellSort::target_record);
+         cells->values[2 * i] = i;
+         cells->keys[2 * i + 1] = cells->key(agents[i].x_pos, agents[i].y_pos, CellSort::position_record);
+         cells->values[2 * i + 1] = i;
+         in_conflict[i] = 0;
+     }
+
+     radix_sort_pairs(cells->keys, cells->values, cells->key_bits);
+
+     const std::vector<uint64_t>& keys = cells->keys;
+     const std::vector<int>& values = cells->values;
+     int num_records = 2 * num_agents;
+
+     #pragma omp parallel for schedule(static)
+     for (int r = 0; r < num_records; r++) {
+         uint64_t cell = keys[r] >> 1;
+         if (r > 0 && (keys[r - 1] >> 1) == cell) {
+             continue;
+         }
+
+         int end = r;
+         int targets = 0, positions = 0;
+         while (end < num_records && (keys[end] >> 1) == cell) {
+             if ((keys[end] & 1) == CellSort::target_record) {
+                 targets++;
+             }
+             else {
+                 positions++;
+             }
+             end++;
+         }
+
+         for (int s = r; s < end; s++) {
+             const Agent& agent = agents[values[s]];
+             bool moving = agent.next_x != agent.x_pos || agent.next_y != agent.y_pos;
+             bool conflict;
+             if ((keys[s] & 1) == CellSort::target_record) {
+                 // contested target, or a target someone is standing on
+                 conflict = targets > 1 || (moving && positions > 0);
+             }
+             else {
+                 // someone else is moving onto the cell this agent leaves
+                 conflict = moving && targets > 0;
+             }
+             if (conflict) {
+                 #pragma omp atomic write
+                 in_conflict[values[s]] = 1;
+             }
+         }
+     }
+ }
+
+ // Agents whose leaves changed in the current refresh, and how many agents
+ // each refresh has had to move in the tree.
+ struct QuadtreeRefresh {
+     std::vector<char> migrating;
+     int migrated = 0;
+     long long total = 0;
+     int most = 0;
+     int steps = 0;
+
+     // called once per step, outside the team
+     void end_step() {
+         PROFILE_MIGRATIONS(migrated);
+         total += migrated;
+         most = std::max(most, migrated);
+         steps++;
+         migrated = 0;
+     }
+ };
+
+ // The first pass only reads the tree: an agent still inside the box cached
+ // with its leaves skips the walk, and the others are looked up again and
+ // marked if their leaves changed. The second pass moves the marked agents in
+ // index order with the same check as before, since a split caused by an
+ // earlier agent may already have put a marked agent in its new leaves.
+ void update_quadtree_team(std::vector<Agent>& agents, int num_agents, std::vector<LeafSet>& agent_leaves, Quadtree *qt,
+                           QuadtreeRefresh& refresh) {
+     PROFILE_THREAD_BEGIN();
+     #pragma omp for schedule(dynamic, 256)
+     for (int i = 0; i < num_agents; i++) {
+         refresh.migrating[i] = 0;
+         if (agent_leaves[i].box_covers(agents[i].x_pos, agents[i].y_pos)) {
+             continue;
+         }
+
+         LeafSet leaves;
+         leaves.open_box();
+         qt->get_leaf_nodes(agents[i], leaves);
+
+         if (leaves.same_leaves(agent_leaves[i])) {
+             agent_leaves[i].copy_box(leaves);
+         }
+         else {
+             refresh.migrating[i] = 1;
+         }
+     }
+
+     int migrated = 0;
+     #pragma omp for schedule(dynamic, 256) nowait
+     for (int i = 0; i < num_agents; i++) {
+         if (!refresh.migrating[i]) {
+             continue;
+         }
+
+         LeafSet leaves;
+         qt->get_leaf_nodes(agents[i], leaves);
+
+         if (!leaves.same_leaves(agent_leaves[i])) {
+            // remove from old quadrants 
+            agent_leaves[i].clear();
+
+            qt->multiRemove(&agents[i]);
+            qt->multiInsert(&agents[i], agent_leaves);
+            migrated++;
+         }
+     }
+     #pragma omp atomic
+     refresh.migrated += migrated;
+     PROFILE_THREAD_END(phase_refresh);
+ }
+
+ void update_quadtree(std::vector<Agent>& agents, int num_agents, std::vector<LeafSet>& agent_leaves, Quadtree *qt,
+                      QuadtreeRefresh& refresh) {
+     #pragma omp parallel
+     update_quadtree_team(agents, num_agents, agent_leaves, qt, refresh);
+ }
+
+ // Agents are relabelled in Morton order of their positions so that agents
+ // next to each other in space are next to each other in memory, and every
+ // phase that walks agents by index touches nearby cells and leaves in turn.
+ // agents[i].id stays equal to i; original_id keeps each agent's file index,
+ // which the corner-turn RNG is keyed on. agent_leaves is permuted along with
+ // the agents and the quadtree's agent pointers are redirected in place, so
+ // the tree does not have to be rebuilt.
+ struct AgentReorder {
+     std::vector<uint64_t> keys;
+     std::vector<int> order; // order[new index] = old index
+     std::vector<int> rank;  // rank[old index] = new index
+     std::vector<Agent> scratch_agents;
+     std::vector<int> scratch_ids;
+     std::vector<LeafSet> scratch_leaves;
+ };
+
+ static void remap_quadtree_agents(Quadtree *node, const Agent *old_base, Agent *new_base, const std::vector<int>& rank) {
+     for (Agent*& a : node->agents) {
+         a = new_base + rank[a - old_base];
+     }
+     if (!node->is_leaf()) {
+         for (int i = 0; i < 4; i++) {
+             remap_quadtree_agents(node->child(i), old_base, new_base, rank);
+         }
+     }
+ }
+
+ void reorder_agents(std::vector<Agent>& agents, int num_agents, int dim_x, int dim_y, std::vector<int>& original_id,
+                     std::vector<LeafSet>& agent_leaves, Quadtree *qt, AgentReorder& r) {
+     r.keys.resize(num_agents);
+     r.order.resize(num_agents);
+     r.rank.resize(num_agents);
+     r.scratch_agents.resize(num_agents);
+     r.scratch_ids.resize(num_agents);
+     r.scratch_leaves.resize(agent_leaves.size());
+
+     #pragma omp parallel for schedule(static)
+     for (int i = 0; i < num_agents; i++) {
+         r.keys[i] = morton_code64(agents[i].x_pos, agents[i].y_pos);
+         r.order[i] = i;
+     }
+     int coord_bits = 1;
+     while ((1ll << coord_bits) < std::max(dim_x, dim_y)) {
+         coord_bits++;
+     }
+     radix_sort_pairs(r.keys, r.order, 2 * coord_bits);
+
+     #pragma omp parallel for schedule(static)
+     for (int i = 0; i < num_agents; i++) {
+         int old = r.order[i];
+         r.rank[old] = i;
+         r.scratch_agents[i] = agents[old];
+         r.scratch_agents[i].id = i;
+         r.scratch_ids[i] = original_id[old];
+         if (!agent_leaves.empty()) {
+             std::swap(r.scratch_leaves[i], agent_leaves[old]);
+         }
+     }
+
+     agents.swap(r.scratch_agents);
+     original_id.swap(r.scratch_ids);
+     agent_leaves.swap(r.scratch_leaves);
+
+     // the tree still points into the old array, now the scratch buffer
+     if (qt != nullptr) {
+         remap_quadtree_agents(qt, r.scratch_agents.data(), agents.data(), r.rank);
+     }
+ }
+
+
  
-                 if(agents[i].next_x > dimX -1 || agents[i].next_x < 0){
-                     agents[i].next_x = agents[i].x_pos;
-                 }
+ // assuming no collisions
+ void move_agent(int agent_id, Agent &agent, int dimX, int dimY, uint64_t seed, int step) { 
+     int currX = agent.x_pos;
+     int currY = agent.y_pos;
+   
+     agent.next_x = agent.x_pos;
+     agent.next_y = agent.y_pos;
+       
+     int direction = -1;
+   
+     // N E S W
+     // 0 1 2 3
+   
+     if(currX == 0 && currY == 0){ // top left
+         // only options are E and S
+         int next_dir = corner_coin(seed, agent_id, step); 
+         if (next_dir == 0){
+             direction = 1; 
+         }
+         else{
+             direction = 2;
+         }
+     } 
+     else if (currX == dimX-1 && currY == 0){ // top right
+         // only options are S and W
+         int next_dir = corner_coin(seed, agent_id, step); 
+         if (next_dir == 0) {
+             direction = 2;
+         }
+         else {
+             direction = 3;
+         }
+     }
+     else if (currX == 0 && currY == dimY-1){ // bottom left
+         // only options are N and E
+         int next_dir = corner_coin(seed, agent_id, step); 
+         if (next_dir == 0) {
+             direction = 0;
+         }
+         else {
+             direction = 1;
+         }
+     }
+     else if (currX == dimX-1 && currY == dimY-1 ){ // bottom right
+         // only options are N and W
+         int next_dir = corner_coin(seed, agent_id, step);
+         if (next_dir == 0) {
+             direction = 0; 
+         }
+         else {
+             direction = 3;
+         }
+     }
+ 
+     else if ((currX == dimX-1 && agent.dir == 1) || (currX == 0 && agent.dir == 3) || (currY == dimY-1 && agent.dir == 2) || (currY == 0 && agent.dir == 0)){
+         // agent is on edge
+         if (currX == dimX-1) { // right
+             direction = 3;
+         }
+         else if (currX == 0) { // left
+             direction = 1;
+         }
+         else if(currY == dimY-1){ // bottom
+             direction = 0;
+         }
+         else { // top
+             direction = 2;
+         }
+     }
+     else { // free space
+         direction = agent.dir;
+     }
+   
+     if (direction == 0) {      
+         agent.next_y = currY - 1;
+     }
+     else if (direction == 1) {
+         agent.next_x = currX + 1;
+     }
+     else if (direction == 2) {
+         agent.next_y = currY + 1;
+     }
+     else if (direction == 3) {
+         agent.next_x = currX - 1;
+     }
+   
+     if(agent.next_x > dimX -1 || agent.next_x < 0 || agent.next_y > dimY -1|| agent.next_y < 0){
+         printf("OUT OF RANGE NEXT X Y, %d %d", agent.next_x, agent.next_y);
+     }
+     agent.dir = direction;
+     
+     return;
+ }
+ 
+ 
+ // grid engine on the structure-of-arrays layout: every phase only streams the
+ // narrow arrays it needs
+ void simulate_soa(AgentSoA& soa, int dim_x, int dim_y, int num_agents, int num_iterations, uint64_t seed, Grid *grid) {
+     std::vector<int> colliders(num_agents);
+
+     for (int iteration_count = 0; iteration_count < num_iterations; iteration_count++) {
+         move_agents_soa(soa, dim_x, dim_y, seed, iteration_count);
+
+         std::fill(colliders.begin(), colliders.end(), -1);
+         grid->build(soa, num_agents);
+         detect_collisions_grid_soa(colliders, soa, num_agents, grid);
+         resolve_collisions_soa(colliders, soa, dim_x, dim_y);
+
+         commit_positions_soa(soa);
+
+         if(!soa.in_range(dim_x, dim_y)){
+             printf("AGENT NOT IN RANGE\n");
+         }
+     }
+ }
+
+ // Same steps as the main loop, but the team is forked once for the whole run
+ // and the phases are separated by barriers. The bitmap and hash engines
+ // bounce every agent on its own, so their commit is folded into the resolve
+ // pass.
+ void simulate_persistent(std::vector<Agent>& agents, int dim_x, int dim_y, int num_agents, int num_iterations, uint64_t seed,
+                          const std::string& engine, std::vector<LeafSet>& agent_leaves, QuadtreeRefresh& refresh, Quadtree *qt,
+                          Grid *grid, ConcurrentQuadtree *cqt, OccupancyBitmap *bitmap, CellHash *hash) {
+     std::vector<int> colliders(num_agents, -1);
+     bool use_grid = (engine == "grid");
+     bool use_concurrent = (engine == "concurrent");
+     bool use_bitmap = (engine == "bitmap");
+     bool use_hash = (engine == "hash");
+     bool flagged = use_bitmap || use_hash;
+     bool use_quadtree = !(use_grid || use_concurrent || flagged);
+     std::vector<char> in_conflict(flagged ? num_agents : 0);
+
+     #pragma omp parallel
+     for (int step = 0; step < num_iterations; step++) {
+         #pragma omp master
+         PROFILE_STEP_BEGIN();
+
+         {
+             PROFILE_THREAD_BEGIN();
+             #pragma omp for schedule(static) nowait
+             for (int i = 0; i < num_agents; i++) {
+                 move_agent(i, agents[i], dim_x, dim_y, seed, step);
+                 colliders[i] = -1;
              }
-             else if(agents[i].dir == 2){
-                 agents[i].dir = 0;
-                 agents[i].next_y = agents[i].y_pos - 1;
-                 if(agents[i].next_y > dimY -1 || agents[i].next_y < 0){
-                     agents[i].next_y = agents[i].y_pos;
+             PROFILE_THREAD_END(phase_move);
+         }
+         #pragma omp barrier
+         #pragma omp master
+         PROFILE_MARK(phase_move);
+
+         if (use_grid) {
+             grid->build_team(agents, num_agents);
+             #pragma omp master
+             PROFILE_MARK(phase_refresh);
+             detect_collisions_grid_team(colliders, agents, num_agents, grid);
+         }
+         else if (use_concurrent) {
+             update_concurrent_quadtree_team(agents, num_agents, cqt);
+             #pragma omp barrier
+             #pragma omp master
+             PROFILE_MARK(phase_refresh);
+             detect_collisions_concurrent_team(colliders, agents, num_agents, cqt);
+         }
+         else if (use_bitmap) {
+             #pragma omp master
+             PROFILE_MARK(phase_refresh);
+             detect_collisions_bitmap_team(in_conflict, agents, num_agents, bitmap);
+         }
+         else if (use_hash) {
+             #pragma omp master
+             PROFILE_MARK(phase_refresh);
+             detect_collisions_hash_team(in_conflict, agents, num_agents, hash);
+         }
+         else {
+             update_quadtree_team(agents, num_agents, agent_leaves, qt, refresh);
+             #pragma omp barrier
+             #pragma omp master
+             PROFILE_MARK(phase_refresh);
+             detect_collisions_team(colliders, agents, num_agents, qt);
+         }
+         #pragma omp barrier
+         #pragma omp master
+         PROFILE_MARK(phase_detect);
+
+         if (flagged) {
+             PROFILE_THREAD_BEGIN();
+             #pragma omp for schedule(static) nowait
+             for (int i = 0; i < num_agents; i++) {
+                 if (in_conflict[i]) {
+                     bounce_agent(agents[i], dim_x, dim_y);
                  }
+                 agents[i].x_pos = agents[i].next_x;
+                 agents[i].y_pos = agents[i].next_y;
+             }
+             PROFILE_THREAD_END(phase_resolve);
+             #pragma omp barrier
+             #pragma omp master
+             {
+                 PROFILE_MARK(phase_resolve);
+                 PROFILE_MARK(phase_commit);
+             }
+         }
+         else {
+             resolve_collisions_team(colliders, agents, num_agents, dim_x, dim_y);
+             #pragma omp barrier
+             #pragma omp master
+             PROFILE_MARK(phase_resolve);
+
+             PROFILE_THREAD_BEGIN();
+             #pragma omp for schedule(static) nowait
+             for (int i = 0; i < num_agents; i++) {
+                 agents[i].x_pos = agents[i].next_x;
+                 agents[i].y_pos = agents[i].next_y;
+             }
+             PROFILE_THREAD_END(phase_commit);
+             #pragma omp barrier
+             #pragma omp master
+             PROFILE_MARK(phase_commit);
+         }
+
+         #pragma omp single
+         {
+             PROFILE_STEP_END();
+             if (use_quadtree) {
+                 refresh.end_step();
+             }
+             if(!is_in_range(agents, num_agents, dim_x, dim_y)){
+                 printf("AGENT NOT IN RANGE\n");
              }
-             else{
-                 agents[i].dir = 1;
-                 agents[i].next_x = agents[i].x_pos + 1;
-                 if(agents[i].next_x > dimX -1 || agents[i].next_x < 0){
-                     agents[i].next_x = agents[i].x_pos;
+         }
+     }
+ }
+
+ // Position and target of an agent near a tile edge, all a neighbouring tile
+ // needs to check its own agents against it.
+ struct HaloAgent {
+     int x_pos, y_pos, next_x, next_y;
+ };
+
+ // A rectangle of cells [x0, x1) x [y0, y1) and the agents standing in it.
+ // Its agents, halo and outbox are only written by the owning thread; the
+ // neighbours read halo and outbox after a barrier. The bit layers are the
+ // bitmap engine's, but over the tile plus a ring of one cell, which is as far
+ // as an own agent's target can reach.
+ struct Tile {
+     int x0, y0, x1, y1;
+     std::vector<int> neighbors;
+
+     std::vector<Agent> agents;
+     std::vector<HaloAgent> halo;
+     std::vector<std::pair<int, Agent>> outbox; // (destination tile, agent)
+
+     int stride;
+     std::vector<uint64_t> target, contested, occupied;
+     std::vector<char> in_conflict;
+
+     void init_layers() {
+         stride = x1 - x0 + 2;
+         size_t words = ((size_t)stride * (y1 - y0 + 2) + 63) / 64;
+         target.assign(words, 0);
+         contested.assign(words, 0);
+         occupied.assign(words, 0);
+     }
+
+     bool in_ring(int x, int y) const {
+         return x >= x0 - 1 && x <= x1 && y >= y0 - 1 && y <= y1;
+     }
+
+     bool inside(int x, int y) const {
+         return x >= x0 && x < x1 && y >= y0 && y < y1;
+     }
+
+     // within two cells of an edge: its current or target cell may fall in a
+     // neighbour's ring
+     bool near_edge(int x, int y) const {
+         return x - x0 < 2 || x1 - 1 - x < 2 || y - y0 < 2 || y1 - 1 - y < 2;
+     }
+
+     size_t cell(int x, int y) const {
+         return (size_t)(y - y0 + 1) * stride + (x - x0 + 1);
+     }
+
+     static bool test(const std::vector<uint64_t>& layer, size_t c) {
+         return (layer[c >> 6] >> (c & 63)) & 1;
+     }
+
+     void mark_target(int x, int y) {
+         size_t c = cell(x, y);
+         uint64_t mask = 1ull << (c & 63);
+         if (target[c >> 6] & mask) {
+             contested[c >> 6] |= mask;
+         }
+         target[c >> 6] |= mask;
+     }
+
+     void mark_occupied(int x, int y) {
+         size_t c = cell(x, y);
+         occupied[c >> 6] |= 1ull << (c & 63);
+     }
+
+     void clear(int x, int y) {
+         size_t w = cell(x, y) >> 6;
+         target[w] = 0;
+         contested[w] = 0;
+         occupied[w] = 0;
+     }
+ };
+
+ // Cuts [0, n) into parts ranges of at least min_side holding about the same
+ // share of prefix[n], where prefix[c] counts the agents before coordinate c.
+ static std::vector<int> cut_by_count(const std::vector<long long>& prefix, int parts, int min_side) {
+     int n = (int)prefix.size() - 1;
+     long long total = prefix[n];
+     std::vector<int> bounds(parts + 1);
+     bounds[0] = 0;
+     bounds[parts] = n;
+     for (int p = 1; p < parts; p++) {
+         int pos;
+         if (total == 0) {
+             pos = (int)((long long)p * n / parts);
+         }
+         else {
+             long long wanted = total * p / parts;
+             pos = (int)(std::lower_bound(prefix.begin(), prefix.end(), wanted) - prefix.begin());
+         }
+         bounds[p] = std::max(bounds[p - 1] + min_side, std::min(pos, n - (parts - p) * min_side));
+     }
+     return bounds;
+ }
+
+ // The grid cut into tiles_y horizontal strips and every strip into tiles_x
+ // tiles, all at least 4x4 cells, about tiles_per_thread for every thread.
+ // The strips split the row histogram of the agents evenly and every strip
+ // splits its own column histogram, so each tile starts with about the same
+ // number of agents however clustered the scene is. Tiles are handed to
+ // threads with the same static schedule in every loop, so a thread keeps its
+ // tiles, their agents and their bit layers in its own cache until the next
+ // rebalance.
+ struct TileGrid {
+     static const int tiles_per_thread = 4;
+     static const int min_side = 4;
+     // how often the load is checked, and how far over its share the
+     // busiest thread may get before the grid is cut again
+     static const int rebalance_steps = 64;
+     static constexpr double max_imbalance = 1.25;
+
+     int dim_x, dim_y;
+     int tiles_x, tiles_y;
+     std::vector<int> row_start;
+     std::vector<std::vector<int>> col_start;
+     std::vector<Tile> tiles;
+
+     TileGrid(int dim_x, int dim_y, int num_threads, const std::vector<Agent>& agents): dim_x(dim_x), dim_y(dim_y) {
+         int wanted = tiles_per_thread * num_threads;
+         tiles_x = (int)std::lround(std::sqrt((double)wanted * dim_x / dim_y));
+         tiles_x = std::max(1, std::min(tiles_x, dim_x / min_side));
+         tiles_y = std::max(1, std::min((wanted + tiles_x - 1) / tiles_x, dim_y / min_side));
+
+         std::vector<long long> rows(dim_y + 1, 0);
+         for (const Agent& agent : agents) {
+             rows[agent.y_pos + 1]++;
+         }
+         for (int y = 0; y < dim_y; y++) {
+             rows[y + 1] += rows[y];
+         }
+         row_start = cut_by_count(rows, tiles_y, min_side);
+
+         std::vector<std::vector<long long>> cols(tiles_y, std::vector<long long>(dim_x + 1, 0));
+         for (const Agent& agent : agents) {
+             cols[strip_of(agent.y_pos)][agent.x_pos + 1]++;
+         }
+         for (int j = 0; j < tiles_y; j++) {
+             for (int x = 0; x < dim_x; x++) {
+                 cols[j][x + 1] += cols[j][x];
+             }
+             col_start.push_back(cut_by_count(cols[j], tiles_x, min_side));
+         }
+
+         // neighbours are the tiles touching this one, corners included,
+         // which in the strips above and below need not line up with it
+         tiles.resize(tiles_x * tiles_y);
+         for (int j = 0; j < tiles_y; j++) {
+             for (int i = 0; i < tiles_x; i++) {
+                 Tile& tile = tiles[j * tiles_x + i];
+                 tile.x0 = col_start[j][i];
+                 tile.x1 = col_start[j][i + 1];
+                 tile.y0 = row_start[j];
+                 tile.y1 = row_start[j + 1];
+                 for (int nj = std::max(0, j - 1); nj <= std::min(tiles_y - 1, j + 1); nj++) {
+                     for (int ni = 0; ni < tiles_x; ni++) {
+                         bool touching = col_start[nj][ni] <= tile.x1 && col_start[nj][ni + 1] >= tile.x0;
+                         if (touching && (ni != i || nj != j)) {
+                             tile.neighbors.push_back(nj * tiles_x + ni);
+                         }
+                     }
                  }
              }
-             
-             if(agents[collider_id].dir == 0){ 
-                 agents[collider_id].dir = 2;
-                 agents[collider_id].next_y = agents[collider_id].y_pos + 1; 
- 
-                 if(agents[collider_id].next_y > dimY -1 || agents[collider_id].next_y < 0){
-                     agents[collider_id].next_y = agents[collider_id].y_pos;
+         }
+
+         #pragma omp parallel for schedule(static)
+         for (int t = 0; t < (int)tiles.size(); t++) {
+             tiles[t].init_layers();
+         }
+     }
+
+     int strip_of(int y) const {
+         return (int)(std::upper_bound(row_start.begin(), row_start.end(), y) - row_start.begin()) - 1;
+     }
+
+     int tile_of(int x, int y) const {
+         int j = strip_of(y);
+         int i = (int)(std::upper_bound(col_start[j].begin(), col_start[j].end(), x) - col_start[j].begin()) - 1;
+         return j * tiles_x + i;
+     }
+
+     // the busiest thread's share of the agents over the average, for the
+     // contiguous blocks of tiles schedule(static) hands out
+     double imbalance(int num_agents, int num_threads) const {
+         int num_tiles = (int)tiles.size();
+         int block = (num_tiles + num_threads - 1) / num_threads;
+         long long most = 0;
+         for (int first = 0; first < num_tiles; first += block) {
+             long long load = 0;
+             for (int t = first; t < std::min(first + block, num_tiles); t++) {
+                 load += tiles[t].agents.size();
+             }
+             most = std::max(most, load);
+         }
+         return (double)most * num_threads / std::max(num_agents, 1);
+     }
+ };
+
+ // Domain decomposition on the bitmap engine's conflict rule. Each step, in
+ // one persistent region:
+ //   1. every tile moves its agents and publishes the ones near its edges;
+ //   2. every tile marks its own agents and its neighbours' halo agents in its
+ //      bit layers, flags its own agents, bounces and commits them, and puts
+ //      the ones that walked out of the tile in its outbox;
+ //   3. every tile picks up the agents addressed to it from its neighbours'
+ //      outboxes.
+ // Agents only ever cross into an adjacent tile, and the corner turns draw
+ // from the agent id, so the result matches the bitmap engine exactly.
+ void simulate_tiled(std::vector<Agent>& agents, int dim_x, int dim_y, int num_agents, int num_iterations, uint64_t seed,
+                     int num_threads) {
+     TileGrid grid(dim_x, dim_y, num_threads, agents);
+     int num_tiles = (int)grid.tiles.size();
+
+     for (int i = 0; i < num_agents; i++) {
+         grid.tiles[grid.tile_of(agents[i].x_pos, agents[i].y_pos)].agents.push_back(agents[i]);
+     }
+
+     #pragma omp parallel
+     for (int step = 0; step < num_iterations; step++) {
+         // agents drift away from the cut they started with; once the
+         // busiest thread holds too much more than its share, cut again from
+         // where the agents are now (same tile count, new bounds)
+         if (step > 0 && step % TileGrid::rebalance_steps == 0) {
+             #pragma omp single
+             if (grid.imbalance(num_agents, num_threads) > TileGrid::max_imbalance) {
+                 for (const Tile& tile : grid.tiles) {
+                     for (const Agent& agent : tile.agents) {
+                         agents[agent.id] = agent;
+                     }
+                 }
+                 grid = TileGrid(dim_x, dim_y, num_threads, agents);
+                 for (int i = 0; i < num_agents; i++) {
+                     grid.tiles[grid.tile_of(agents[i].x_pos, agents[i].y_pos)].agents.push_back(agents[i]);
                  }
              }
-             else if(agents[collider_id].dir == 1){
-                 agents[collider_id].dir = 3;
-                 agents[collider_id].next_x = agents[collider_id].x_pos - 1;
- 
-                 if(agents[collider_id].next_x > dimX -1 || agents[collider_id].next_x < 0){
-                     agents[collider_id].next_x = agents[collider_id].x_pos;
+         }
+
+         #pragma omp master
+         PROFILE_STEP_BEGIN();
+
+         {
+             PROFILE_THREAD_BEGIN();
+             #pragma omp for schedule(static)
+             for (int t = 0; t < num_tiles; t++) {
+                 Tile& tile = grid.tiles[t];
+                 tile.halo.clear();
+                 for (Agent& agent : tile.agents) {
+                     move_agent(agent.id, agent, dim_x, dim_y, seed, step);
+                     if (tile.near_edge(agent.x_pos, agent.y_pos)) {
+                         tile.halo.push_back({agent.x_pos, agent.y_pos, agent.next_x, agent.next_y});
+                     }
                  }
              }
-             else if(agents[collider_id].dir == 2){
-                 agents[collider_id].dir = 0;
-                 agents[collider_id].next_y = agents[collider_id].y_pos - 1;
-                 if(agents[collider_id].next_y > dimY -1 || agents[collider_id].next_y < 0){
-                     agents[collider_id].next_y = agents[collider_id].y_pos;
+             PROFILE_THREAD_END(phase_move);
+         }
+         #pragma omp master
+         PROFILE_MARK(phase_move);
+
+         {
+             PROFILE_THREAD_BEGIN();
+             #pragma omp for schedule(static)
+             for (int t = 0; t < num_tiles; t++) {
+                 Tile& tile = grid.tiles[t];
+                 tile.outbox.clear();
+
+                 for (const Agent& agent : tile.agents) {
+                     tile.mark_target(agent.next_x, agent.next_y);
+                     tile.mark_occupied(agent.x_pos, agent.y_pos);
+                 }
+                 for (int n : tile.neighbors) {
+                     for (const HaloAgent& h : grid.tiles[n].halo) {
+                         if (tile.in_ring(h.next_x, h.next_y)) {
+                             tile.mark_target(h.next_x, h.next_y);
+                         }
+                         if (tile.in_ring(h.x_pos, h.y_pos)) {
+                             tile.mark_occupied(h.x_pos, h.y_pos);
+                         }
+                     }
+                 }
+
+                 int count = (int)tile.agents.size();
+                 tile.in_conflict.resize(count);
+                 for (int k = 0; k < count; k++) {
+                     const Agent& agent = tile.agents[k];
+                     size_t next = tile.cell(agent.next_x, agent.next_y);
+                     size_t curr = tile.cell(agent.x_pos, agent.y_pos);
+
+                     bool conflict = Tile::test(tile.contested, next);
+                     if (next != curr) {
+                         conflict = conflict || Tile::test(tile.target, curr) || Tile::test(tile.occupied, next);
+                     }
+                     tile.in_conflict[k] = conflict;
+                 }
+
+                 for (const Agent& agent : tile.agents) {
+                     tile.clear(agent.next_x, agent.next_y);
+                     tile.clear(agent.x_pos, agent.y_pos);
+                 }
+                 for (int n : tile.neighbors) {
+                     for (const HaloAgent& h : grid.tiles[n].halo) {
+                         if (tile.in_ring(h.next_x, h.next_y)) {
+                             tile.clear(h.next_x, h.next_y);
+                         }
+                         if (tile.in_ring(h.x_pos, h.y_pos)) {
+                             tile.clear(h.x_pos, h.y_pos);
+                         }
+                     }
                  }
+
+                 // bounce and commit, moving the agents that left to the outbox
+                 int kept = 0;
+                 for (int k = 0; k < count; k++) {
+                     Agent agent = tile.agents[k];
+                     if (tile.in_conflict[k]) {
+                         bounce_agent(agent, dim_x, dim_y);
+                     }
+                     agent.x_pos = agent.next_x;
+                     agent.y_pos = agent.next_y;
+
+                     if (tile.inside(agent.x_pos, agent.y_pos)) {
+                         tile.agents[kept++] = agent;
+                     }
+                     else {
+                         tile.outbox.push_back({grid.tile_of(agent.x_pos, agent.y_pos), agent});
+                     }
+                 }
+                 tile.agents.resize(kept);
              }
-             else{
-                 agents[collider_id].dir = 1;
-                 agents[collider_id].next_x = agents[collider_id].x_pos + 1;
-                 if(agents[collider_id].next_x > dimX -1 || agents[collider_id].next_x < 0){
-                     agents[collider_id].next_x = agents[collider_id].x_pos;
+             PROFILE_THREAD_END(phase_detect);
+         }
+         #pragma omp master
+         {
+             PROFILE_MARK(phase_detect);
+             PROFILE_MARK(phase_resolve);
+         }
+
+         {
+             PROFILE_THREAD_BEGIN();
+             #pragma omp for schedule(static)
+             for (int t = 0; t < num_tiles; t++) {
+                 Tile& tile = grid.tiles[t];
+                 for (int n : tile.neighbors) {
+                     for (const auto& moved : grid.tiles[n].outbox) {
+                         if (moved.first == t) {
+                             tile.agents.push_back(moved.second);
+                         }
+                     }
                  }
              }
-         
+             PROFILE_THREAD_END(phase_commit);
+         }
+         #pragma omp master
+         {
+             PROFILE_MARK(phase_commit);
+             PROFILE_STEP_END();
          }
      }
- }
-
 
+     #pragma omp parallel for schedule(static)
+     for (int t = 0; t < num_tiles; t++) {
+         for (const Agent& agent : grid.tiles[t].agents) {
+             agents[agent.id] = agent;
+         }
+     }
 
-void detect_collisions(std::vector<int>& colliders, std::vector<Agent>& agents, int num_agents, Quadtree* qt) {
-    #pragma omp parallel for schedule(dynamic)
-    for (int i = 0; i < num_agents; i++) {
+     if(!is_in_range(agents, num_agents, dim_x, dim_y)){
+         printf("AGENT NOT IN RANGE\n");
+     }
+ }
 
-        Quadtree* leaf = qt->get_leaf(agents[i]);
-        std::vector<Agent*> collidable_agents = leaf->collidable_agents();
+ // agent-steps taken one by one against the ones skipped by fast-forwarding
+ struct EventSummary {
+     long long stepped = 0;
+     long long sleeps = 0;
+ };
 
-        for (const auto& possible_collider : collidable_agents) {
-            if (possible_collider->id != agents[i].id &&
-                ((agents[i].next_x == possible_collider->next_x &&
-                agents[i].next_y == possible_collider->next_y) || 
-                (agents[i].x_pos == possible_collider->next_x &&
-                agents[i].y_pos == possible_collider->next_y))) {
-                
-                #pragma omp atomic write
-                colliders[i] = possible_collider->id;
+ // Event-driven stepping on the flagged engines. Only the awake agents are
+ // moved, detected and resolved each step; every other agent sleeps until the
+ // step in its wake-up event, when its free motion is replayed in one jump.
+ // An agent goes to sleep when, by FastForward's bound, nobody can come
+ // within two cells of it and it reaches no corner for at least min_sleep
+ // steps, so the flagged rule sees the same conflicts it would with every
+ // agent present and the end state matches the regions mode exactly.
+ void simulate_events(std::vector<Agent>& agents, int dim_x, int dim_y, int num_agents, int num_iterations, uint64_t seed,
+                      const std::string& engine, OccupancyBitmap* bitmap, CellSort* cell_sort, CellHash* cell_hash,
+                      EventSummary& summary) {
+     FastForward ff(dim_x, dim_y, agents);
+     StepKernels kernels = select_step_kernels(dim_x, dim_y);
+     std::vector<int> awake(num_agents);
+     for (int i = 0; i < num_agents; i++) {
+         awake[i] = i;
+     }
+     std::vector<Agent> active;
+     std::vector<char> in_conflict(num_agents);
+     std::vector<int> wake(num_agents);
+     // an agent turned down for a sleep is not asked again for min_sleep
+     // steps; staying awake is always safe, and in a crowd it saves the search
+     std::vector<int> retry(num_agents, 0);
 
-                break; 
-            }
-        }
-    }
-}
+     for (int step = 0; step < num_iterations; step++) {
+         PROFILE_STEP_BEGIN();
 
+         ff.wake_due(agents, step, awake);
+         int count = (int)awake.size();
+         summary.stepped += count;
+         active.resize(count);
 
- 
- // assuming no collisions
- void move_agent(int agent_id, Agent &agent, int dimX, int dimY, std::mt19937 generator) { 
-     int currX = agent.x_pos;
-     int currY = agent.y_pos;
-   
-     agent.next_x = agent.x_pos;
-     agent.next_y = agent.y_pos;
-       
-     int direction = -1;
-   
-     // N E S W
-     // 0 1 2 3
-     std::uniform_int_distribution<int> dist_2(0, 1);
-     std::uniform_int_distribution<int> dist_3(0, 2);
-   
-     if(currX == 0 && currY == 0){ // top left
-         // only options are E and S
-         int next_dir = dist_2(generator); 
-         if (next_dir == 0){
-             direction = 1; 
-         }
-         else{
-             direction = 2;
-         }
-     } 
-     else if (currX == dimX-1 && currY == 0){ // top right
-         // only options are S and W
-         int next_dir = dist_2(generator); 
-         if (next_dir == 0) {
-             direction = 2;
-         }
-         else {
-             direction = 3;
-         }
-     }
-     else if (currX == 0 && currY == dimY-1){ // bottom left
-         // only options are N and E
-         int next_dir = dist_2(generator); 
-         if (next_dir == 0) {
-             direction = 0;
+         // awake doubles as the ids of the compacted agents for the corner coin
+         #pragma omp parallel
+         {
+             #pragma omp for schedule(static)
+             for (int k = 0; k < count; k++) {
+                 active[k] = agents[awake[k]];
+             }
+             kernels.move_team(active, count, awake, dim_x, dim_y, seed, step);
          }
-         else {
-             direction = 1;
+         PROFILE_MARK(phase_move);
+
+         if (engine == "bitmap") {
+             detect_collisions_bitmap(in_conflict, active, count, bitmap);
          }
-     }
-     else if (currX == dimX-1 && currY == dimY-1 ){ // bottom right
-         // only options are N and W
-         int next_dir = dist_2(generator);
-         if (next_dir == 0) {
-             direction = 0; 
+         else if (engine == "sort") {
+             detect_collisions_sort(in_conflict, active, count, cell_sort);
          }
          else {
-             direction = 3;
+             detect_collisions_hash(in_conflict, active, count, cell_hash);
          }
-     }
- 
-     else if ((currX == dimX-1 && agent.dir == 1) || (currX == 0 && agent.dir == 3) || (currY == dimY-1 && agent.dir == 2) || (currY == 0 && agent.dir == 0)){
-         // agent is on edge
-         if (currX == dimX-1) { // right
-             direction = 3;
+         PROFILE_MARK(phase_detect);
+
+         #pragma omp parallel
+         kernels.resolve_conflicts_team(in_conflict, active, count, dim_x, dim_y);
+         PROFILE_MARK(phase_resolve);
+
+         #pragma omp parallel for schedule(static)
+         for (int k = 0; k < count; k++) {
+             active[k].x_pos = active[k].next_x;
+             active[k].y_pos = active[k].next_y;
+             agents[awake[k]] = active[k];
          }
-         else if (currX == 0) { // left
-             direction = 1;
+         for (int k = 0; k < count; k++) {
+             ff.moved(awake[k], active[k]);
          }
-         else if(currY == dimY-1){ // bottom
-             direction = 0;
+
+         // the wake-ups are computed against every position recorded above,
+         // then the sleepers leave the awake list in order
+         #pragma omp parallel for schedule(dynamic, 64)
+         for (int k = 0; k < count; k++) {
+             int i = awake[k];
+             wake[k] = step + 1;
+             if (retry[i] <= step + 1) {
+                 wake[k] = ff.wake_step(active[k], i, step + 1);
+                 if (wake[k] - (step + 1) < FastForward::min_sleep) {
+                     retry[i] = step + 1 + FastForward::min_sleep;
+                 }
+             }
          }
-         else { // top
-             direction = 2;
+         int kept = 0;
+         for (int k = 0; k < count; k++) {
+             if (wake[k] - (step + 1) >= FastForward::min_sleep) {
+                 ff.sleep(active[k], awake[k], step + 1, wake[k]);
+             }
+             else {
+                 awake[kept++] = awake[k];
+             }
          }
+         awake.resize(kept);
+         PROFILE_MARK(phase_commit);
+         PROFILE_STEP_END();
      }
-     else { // free space
-         direction = agent.dir;
-     }
-   
-     if (direction == 0) {      
-         agent.next_y = currY - 1;
-     }
-     else if (direction == 1) {
-         agent.next_x = currX + 1;
-     }
-     else if (direction == 2) {
-         agent.next_y = currY + 1;
-     }
-     else if (direction == 3) {
-         agent.next_x = currX - 1;
-     }
-   
-     if(agent.next_x > dimX -1 || agent.next_x < 0 || agent.next_y > dimY -1|| agent.next_y < 0){
-         printf("OUT OF RANGE NEXT X Y, %d %d", agent.next_x, agent.next_y);
+
+     ff.finish(agents, num_iterations);
+     summary.sleeps = ff.sleeps;
+
+     if(!is_in_range(agents, num_agents, dim_x, dim_y)){
+         printf("AGENT NOT IN RANGE\n");
      }
-     agent.dir = direction;
-     
-     return;
  }
- 
- 
+
+
  void printQuadtree(const Quadtree &node, int level = 0) {
      std::string indent(level * 2, ' ');
  
@@ -247,14 +1563,15 @@ void detect_collisions(std::vector<int>& colliders, std::vector<Agent>& agents,
                << node.max_x << ", " << node.max_y << "], Agents: " << node.agents.size() << "\n";
      
      for (int i = 0; i < 4; i++) {
-         if (node.children[i] != nullptr) {
+         if (!node.is_leaf()) {
              std::cout << indent << "Child " << i << ":\n";
-             printQuadtree(*(node.children[i]), level + 1);
+             printQuadtree(*(node.child(i)), level + 1);
          }
      }
  }
  
  
+ #ifdef VISUALIZE
  void render_agents(SDL_Renderer* renderer, const std::vector<Agent>& agents, int dim_x, int dim_y, const std::vector<std::tuple<int, int, int>>& agent_colors) {
      SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255); // white background
      SDL_RenderClear(renderer);
@@ -274,7 +1591,7 @@ void detect_collisions(std::vector<int>& colliders, std::vector<Agent>& agents,
      SDL_RenderPresent(renderer);
  }
 
-  void visualize_simulation(std::vector<Agent>& agents, int dim_x, int dim_y, int num_agents, int num_threads, int num_iterations,  const std::vector<std::tuple<int, int, int>>& agent_colors, std::vector<std::vector<int>>& agent_leaves, Quadtree *qt) {
+  void visualize_simulation(std::vector<Agent>& agents, int dim_x, int dim_y, int num_agents, int num_threads, int num_iterations, uint64_t seed, const std::vector<std::tuple<int, int, int>>& agent_colors, std::vector<LeafSet>& agent_leaves, Quadtree *qt, QuadtreeRefresh& refresh) {
       if (SDL_Init(SDL_INIT_VIDEO) < 0) {
           std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
           return;
@@ -309,32 +1626,13 @@ void detect_collisions(std::vector<int>& colliders, std::vector<Agent>& agents,
 
 
         // move agent
-        #pragma omp parallel
-         {
-             std::mt19937 generator(std::random_device{}() + omp_get_thread_num());
-             #pragma omp for schedule(dynamic, num_threads)
-             for (int i = 0; i < num_agents; i++) {
-                 move_agent(i, agents[i], dim_x, dim_y, generator);
-             }
+         #pragma omp parallel for schedule(static)
+         for (int i = 0; i < num_agents; i++) {
+             move_agent(i, agents[i], dim_x, dim_y, seed, iteration_count);
          }
 
-         #pragma omp parallel for schedule(dynamic)
-         for(int i = 0; i < num_agents; i++) {
-
-             std::vector<int> leaves;
-             qt->get_leaf_nodes(agents[i], leaves);
-
-             std::unordered_set<int> set_a(leaves.begin(), leaves.end());
-             std::unordered_set<int> set_b(agent_leaves[i].begin(), agent_leaves[i].end());
-         
-             if (set_a != set_b){
-                // remove from old quadrants 
-                agent_leaves[i].clear();
-
-                qt->multiRemove(&agents[i]);
-                qt->multiInsert(&agents[i], agent_leaves);
-             }
-         }
+         update_quadtree(agents, num_agents, agent_leaves, qt, refresh);
+         refresh.end_step();
 
          std::vector<int> colliders(num_agents, -1);
          detect_collisions(colliders, agents, num_agents, qt);
@@ -361,17 +1659,71 @@ void detect_collisions(std::vector<int>& colliders, std::vector<Agent>& agents,
      SDL_DestroyWindow(window);
      SDL_Quit();
   }
+ #endif
 
  
+ // the final positions and directions in the input's text format, in file
+ // order, so two runs can be compared with cmp
+ bool write_agents(const std::string& filename, int dim_x, int dim_y, const std::vector<Agent>& agents) {
+     std::ofstream fout(filename);
+     if (!fout) {
+         return false;
+     }
+     fout << dim_x << " " << dim_y << "\n" << agents.size() << "\n";
+     for (const Agent& agent : agents) {
+         fout << agent.x_pos << " " << agent.y_pos << " " << agent.dir << "\n";
+     }
+     return (bool)fout;
+ }
+
+ const std::vector<std::string> engines = {"quadtree", "leaves", "grid", "linear", "concurrent", "bitmap", "sort", "hash", "verlet"};
+
+ void print_usage(const char *prog) {
+     std::cerr << "Usage: " << prog << " -f input_filename -i num_iterations -n num_threads [options]\n";
+     std::cerr << "  -e engine    collision engine:";
+     for (const auto& name : engines) {
+         std::cerr << " " << name;
+     }
+     std::cerr << " (default quadtree)\n";
+     std::cerr << "  -l layout    agent layout: aos or soa (soa needs -e grid)\n";
+     std::cerr << "  -s seed      seed for the corner turns (default random)\n";
+     std::cerr << "  -m mode      regions (a parallel region per phase, default) or\n";
+     std::cerr << "               persistent (one region for the whole run, no -e linear/leaves/sort/verlet) or\n";
+     std::cerr << "               tiled (thread-owned tiles exchanging edge agents, needs -e bitmap) or\n";
+     std::cerr << "               events (fast-forward agents in free space, needs -e bitmap/sort/hash)\n";
+     std::cerr << "  -a agents    quadtree leaf capacity before a split (default 4)\n";
+     std::cerr << "  -d depth     quadtree depth limit (default 5)\n";
+     std::cerr << "  -r steps     reorder the agents along a Morton curve every so many steps\n";
+     std::cerr << "               (default 0, never; -m regions with -l aos only)\n";
+     std::cerr << "  -u tuner     off (default), density (pick -a/-d from the agent density) or\n";
+     std::cerr << "               adaptive (density, then adjust the depth between steps; -e quadtree/leaves)\n";
+     std::cerr << "  -k steps     steps between neighbor list rebuilds for -e verlet (default 2)\n";
+     std::cerr << "  -c           check every step of -e verlet against the grid engine\n";
+     std::cerr << "  -t           only check the agents with another agent nearby (-e quadtree, -m regions)\n";
+     std::cerr << "  -o file      write the final agents to file, in the input's text format\n";
+ }
+
  int main(int argc, char *argv[]) {
      const auto init_start = std::chrono::steady_clock::now();
     
      std::string input_filename;
+     std::string output_filename;
      int num_threads = 0;
      int num_iterations = 0;
+     std::string engine = "quadtree";
+     std::string layout = "aos";
+     std::string mode = "regions";
+     std::string tuner = "off";
+     int split_agents = 0;
+     int split_depth = -1;
+     int reorder_interval = 0;
+     int reuse_steps = 2;
+     bool check_neighbors = false;
+     bool track_active = false;
+     uint64_t seed = std::random_device{}();
    
      int opt;
-     while ((opt = getopt(argc, argv, "f:i:n:")) != -1) {
+     while ((opt = getopt(argc, argv, "f:i:n:e:l:s:m:a:d:u:r:k:cto:")) != -1) {
          switch (opt) {
          case 'f':
              input_filename = optarg;
@@ -382,43 +1734,112 @@ void detect_collisions(std::vector<int>& colliders, std::vector<Agent>& agents,
          case 'n':
              num_threads = atoi(optarg);
              break;
+         case 'e':
+             engine = optarg;
+             break;
+         case 'l':
+             layout = optarg;
+             break;
+         case 's':
+             seed = strtoull(optarg, nullptr, 10);
+             break;
+         case 'm':
+             mode = optarg;
+             break;
+         case 'a':
+             split_agents = atoi(optarg);
+             break;
+         case 'd':
+             split_depth = atoi(optarg);
+             break;
+         case 'u':
+             tuner = optarg;
+             break;
+         case 'r':
+             reorder_interval = atoi(optarg);
+             break;
+         case 'k':
+             reuse_steps = atoi(optarg);
+             break;
+         case 'c':
+             check_neighbors = true;
+             break;
+         case 't':
+             track_active = true;
+             break;
+         case 'o':
+             output_filename = optarg;
+             break;
          default:
-             std::cerr << "Usage: " << argv[0] << " -f input_filename\n";
+             print_usage(argv[0]);
              exit(EXIT_FAILURE);
          }
      }
  
      // check if required options are provided
-     if (empty(input_filename) ||  num_iterations <= 0 || num_threads <= 0) {
-         std::cerr << "Usage: " << argv[0] << " -f input_filename\n";
+     if (empty(input_filename) ||  num_iterations <= 0 || num_threads <= 0 ||
+         std::find(engines.begin(), engines.end(), engine) == engines.end() ||
+         (layout != "aos" && layout != "soa") || (mode != "regions" && mode != "persistent" && mode != "tiled" &&
+         mode != "events") ||
+         (tuner != "off" && tuner != "density" && tuner != "adaptive") ||
+         split_agents < 0 || split_depth < -1 || reorder_interval < 0 || reuse_steps < 1) {
+         print_usage(argv[0]);
+         exit(EXIT_FAILURE);
+     }
+ 
+     if (layout == "soa" && engine != "grid") {
+         std::cerr << "The soa layout is only supported by the grid engine.\n";
+         exit(EXIT_FAILURE);
+     }
+     if (mode == "persistent" && (layout == "soa" || engine == "linear" || engine == "leaves" || engine == "sort" ||
+                                  engine == "verlet")) {
+         std::cerr << "The persistent mode needs the aos layout and does not support the linear, leaves, sort or verlet engines.\n";
+         exit(EXIT_FAILURE);
+     }
+     if (mode == "tiled" && (layout != "aos" || engine != "bitmap")) {
+         std::cerr << "The tiled mode needs the aos layout and the bitmap engine.\n";
+         exit(EXIT_FAILURE);
+     }
+     if (mode == "events" && (layout != "aos" || (engine != "bitmap" && engine != "sort" && engine != "hash"))) {
+         std::cerr << "The events mode needs the aos layout and the bitmap, sort or hash engine.\n";
+         exit(EXIT_FAILURE);
+     }
+     if (reorder_interval > 0 && (mode != "regions" || layout != "aos")) {
+         std::cerr << "Reordering needs the regions mode and the aos layout.\n";
+         exit(EXIT_FAILURE);
+     }
+     if (check_neighbors && engine != "verlet") {
+         std::cerr << "The neighbor list check needs the verlet engine.\n";
+         exit(EXIT_FAILURE);
+     }
+     if (track_active && (engine != "quadtree" || mode != "regions")) {
+         std::cerr << "Active set tracking needs the quadtree engine in the regions mode.\n";
+         exit(EXIT_FAILURE);
+     }
+     if (tuner == "adaptive" && (mode != "regions" || layout != "aos" || (engine != "quadtree" && engine != "leaves"))) {
+         std::cerr << "The adaptive tuner needs the regions mode with the quadtree or leaves engine.\n";
          exit(EXIT_FAILURE);
      }
  
      omp_set_num_threads(num_threads);
+     PROFILE_INIT(num_threads);
     
-     std::ifstream fin(input_filename);
+     int dim_x, dim_y;
+     std::vector<Agent> agents;
     
-     if (!fin) {
+     // read the grid dimension and agent information from file (text or binary)
+     if (!load_scenario(input_filename, dim_x, dim_y, agents)) {
          std::cerr << "Unable to open file: " << input_filename << ".\n";
          exit(EXIT_FAILURE);
      }
-    
-     int dim_x, dim_y;
-     int num_agents;
-    
-     // read the grid dimension and agent information from file
-     fin >> dim_x >> dim_y >> num_agents;
-    
-     std::vector<Agent> agents(num_agents);
- 
-     int id_counter = 0;
+     int num_agents = (int)agents.size();
    
-     for (auto& agent : agents) {
-         fin >> agent.x_pos >> agent.y_pos >> agent.dir;
-         agent.next_x = agent.x_pos;
-         agent.next_y = agent.y_pos;
-         agent.id = id_counter;
-         id_counter++;
+     // agents[i].id is the agent's current index, original_id its index in
+     // the file; they only differ once -r has reordered the agents
+     std::vector<int> original_id(num_agents);
+     for (int i = 0; i < num_agents; i++) {
+         agents[i].id = i;
+         original_id[i] = i;
      }
    
      std::vector<std::tuple<int, int, int>> agent_colors;
@@ -427,72 +1848,270 @@ void detect_collisions(std::vector<int>& colliders, std::vector<Agent>& agents,
      std::mt19937 gen(rd());
      std::uniform_int_distribution<> color_dist(0, 255);
 
-     /* Uncomment the following section to use the simulation
+     #ifdef VISUALIZE
      for (int i = 0; i < num_agents; i++) {
          agent_colors.push_back({
              color_dist(gen), color_dist(gen), color_dist(gen)
          });
      }
-     */
+     #endif
     
-     std::vector<std::vector<int>> agent_leaves(num_agents);
+     if (layout == "soa" && (dim_x > soa_max_dim || dim_y > soa_max_dim)) {
+         std::cerr << "Grid too large for the soa layout.\n";
+         exit(EXIT_FAILURE);
+     }
+     if (engine == "bitmap" && (long long)dim_x * dim_y > (1ll << 32)) {
+         std::cerr << "Grid too large for the bitmap engine.\n";
+         exit(EXIT_FAILURE);
+     }
+     if (track_active && ActiveSet::num_blocks(dim_x, dim_y) > (1ll << 26)) {
+         std::cerr << "Grid too large for active set tracking.\n";
+         exit(EXIT_FAILURE);
+     }
+     if (engine == "linear" && (dim_x > 65536 || dim_y > 65536)) {
+         std::cerr << "Grid too large for the linear quadtree.\n";
+         exit(EXIT_FAILURE);
+     }
+     // explicit -a/-d win over whatever the tuner picks
+     if (tuner != "off") {
+         pick_split_from_density(dim_x, dim_y, num_agents);
+     }
+     if (split_agents > 0) {
+         max_agents = split_agents;
+     }
+     if (split_depth >= 0) {
+         max_depth = split_depth;
+     }
+     SplitTuner *split_tuner = nullptr;
+     if (tuner == "adaptive") {
+         split_tuner = new SplitTuner(dim_x, dim_y);
+     }
+
+     AgentSoA soa;
+     if (layout == "soa") {
+         soa.load(agents);
+     }
+
+     // only the structures the chosen engine reads are allocated; with a
+     // binary scenario the per-agent leaf sets used to cost more than loading
+     #ifdef VISUALIZE
+     bool uses_tree = true;
+     #else
+     bool uses_tree = (engine == "quadtree" || engine == "leaves");
+     #endif
+     std::vector<LeafSet> agent_leaves;
+     QuadtreeRefresh quadtree_refresh;
+     if (uses_tree) {
+         agent_leaves.resize(num_agents);
+         quadtree_refresh.migrating.resize(num_agents);
+     }
      Quadtree *qt = new Quadtree(0, 0, dim_x-1, dim_y-1, 0);
+     Grid *grid = nullptr;
+     LinearQuadtree *lqt = nullptr;
+     ConcurrentQuadtree *cqt = nullptr;
+     if (engine == "grid" || check_neighbors) {
+         grid = new Grid(dim_x, dim_y, Grid::suggest_cell_size(dim_x, dim_y, num_agents));
+     }
+     if (engine == "linear") {
+         lqt = new LinearQuadtree(dim_x, dim_y);
+     }
+     if (engine == "concurrent") {
+         cqt = new ConcurrentQuadtree(0, 0, dim_x-1, dim_y-1, 0);
+     }
+     OccupancyBitmap *bitmap = nullptr;
+     LeafIndex leaf_index;
+     std::vector<char> in_conflict;
+     CellSort *cell_sort = nullptr;
+     CellHash *cell_hash = nullptr;
+     NeighborList *neighbor_list = nullptr;
+     EventSummary event_summary;
+     ActiveSet *active_set = nullptr;
+     long long active_checked = 0;
+     // the tiled mode keeps its own bit layers per tile
+     if (engine == "bitmap" && mode != "tiled") {
+         bitmap = new OccupancyBitmap(dim_x, dim_y);
+         in_conflict.resize(num_agents);
+     }
+     if (engine == "sort") {
+         cell_sort = new CellSort(dim_x, dim_y);
+         in_conflict.resize(num_agents);
+     }
+     if (engine == "hash") {
+         // at most a target and a current cell per agent
+         cell_hash = new CellHash(2 * num_agents);
+         in_conflict.resize(num_agents);
+     }
+     if (engine == "verlet") {
+         neighbor_list = new NeighborList(dim_x, dim_y, num_agents, reuse_steps);
+     }
+     if (track_active) {
+         active_set = new ActiveSet(dim_x, dim_y);
+         active_set->build(agents, num_agents);
+     }
       
      const double init_time = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - init_start).count();
      std::cout << "Initialization time (sec): " << std::fixed << std::setprecision(10) << init_time << '\n';
 
     const auto compute_start = std::chrono::steady_clock::now();
 
-    for (int i = 0; i < num_agents; i++) {
-        qt->multiInsert(&agents[i], agent_leaves);
-
+    if (engine == "quadtree" || engine == "leaves") {
+        qt->bulk_load(agents, num_agents, agent_leaves);
     }
     int iteration_count = 0;
 
-    /* Uncomment the following line and comment the while loop to use the simulation 
-    visualize_simulation(agents, dim_x, dim_y, num_agents, num_threads, num_iterations, agent_colors, agent_leaves, qt);
-    */
+    // the visualization runs its own loop, so skip the timed one
+    #ifdef VISUALIZE
+    visualize_simulation(agents, dim_x, dim_y, num_agents, num_threads, num_iterations, seed, agent_colors, agent_leaves, qt, quadtree_refresh);
+    iteration_count = num_iterations;
+    #endif
  
-     while (iteration_count < num_iterations) {
+     if (layout == "soa") {
+         simulate_soa(soa, dim_x, dim_y, num_agents, num_iterations, seed, grid);
+         soa.store(agents);
+         iteration_count = num_iterations;
+     }
+     else if (mode == "persistent") {
+         simulate_persistent(agents, dim_x, dim_y, num_agents, num_iterations, seed, engine, agent_leaves, quadtree_refresh, qt, grid,
+                             cqt, bitmap, cell_hash);
+         iteration_count = num_iterations;
+     }
+     else if (mode == "tiled") {
+         simulate_tiled(agents, dim_x, dim_y, num_agents, num_iterations, seed, num_threads);
+         iteration_count = num_iterations;
+     }
+     else if (mode == "events") {
+         simulate_events(agents, dim_x, dim_y, num_agents, num_iterations, seed, engine, bitmap, cell_sort, cell_hash,
+                         event_summary);
+         iteration_count = num_iterations;
+     }
 
-        // move agent
-        #pragma omp parallel
-         {
-             std::mt19937 generator(std::random_device{}() + omp_get_thread_num());
-             #pragma omp for schedule(dynamic, num_threads)
-             for (int i = 0; i < num_agents; i++) {
-                 move_agent(i, agents[i], dim_x, dim_y, generator);
+     // move and resolve kernels for this grid shape, picked once
+     StepKernels kernels = select_step_kernels(dim_x, dim_y);
+     bool flagged = (engine == "bitmap" || engine == "sort" || engine == "hash");
+
+     AgentReorder reorder;
+     bool reordered = false;
+     bool tree_built = (engine == "quadtree" || engine == "leaves");
+
+     while (iteration_count < num_iterations) {
+         if (reorder_interval > 0 && iteration_count % reorder_interval == 0) {
+             reorder_agents(agents, num_agents, dim_x, dim_y, original_id, agent_leaves, tree_built ? qt : nullptr, reorder);
+             if (neighbor_list != nullptr) {
+                 neighbor_list->invalidate();
+             }
+             if (active_set != nullptr) {
+                 active_set->build(agents, num_agents);
              }
+             reordered = true;
          }
 
-         #pragma omp parallel for schedule(dynamic)
-         for(int i = 0; i < num_agents; i++) {
-
-             std::vector<int> leaves;
-             qt->get_leaf_nodes(agents[i], leaves);
+         PROFILE_STEP_BEGIN();
 
-             std::unordered_set<int> set_a(leaves.begin(), leaves.end());
-             std::unordered_set<int> set_b(agent_leaves[i].begin(), agent_leaves[i].end());
-         
-             if (set_a != set_b){
-                // remove from old quadrants 
-                agent_leaves[i].clear();
+        // move agent
+         #pragma omp parallel
+         {
+             PROFILE_THREAD_BEGIN();
+             kernels.move_team(agents, num_agents, original_id, dim_x, dim_y, seed, iteration_count);
+             PROFILE_THREAD_END(phase_move);
+         }
+         PROFILE_MARK(phase_move);
 
-                qt->multiRemove(&agents[i]);
-                qt->multiInsert(&agents[i], agent_leaves);
+         std::vector<int> colliders(num_agents, -1);
+         double detect_start = omp_get_wtime();
+         if (engine == "grid") {
+             grid->build(agents, num_agents);
+             PROFILE_MARK(phase_refresh);
+             detect_collisions_grid(colliders, agents, num_agents, grid);
+         }
+         else if (engine == "linear") {
+             lqt->build(agents, num_agents);
+             PROFILE_MARK(phase_refresh);
+             detect_collisions_linear(colliders, agents, num_agents, lqt);
+         }
+         else if (engine == "concurrent") {
+             update_concurrent_quadtree(agents, num_agents, cqt);
+             PROFILE_MARK(phase_refresh);
+             detect_collisions_concurrent(colliders, agents, num_agents, cqt);
+         }
+         else if (engine == "bitmap") {
+             PROFILE_MARK(phase_refresh);
+             detect_collisions_bitmap(in_conflict, agents, num_agents, bitmap);
+         }
+         else if (engine == "sort") {
+             PROFILE_MARK(phase_refresh);
+             detect_collisions_sort(in_conflict, agents, num_agents, cell_sort);
+         }
+         else if (engine == "hash") {
+             PROFILE_MARK(phase_refresh);
+             detect_collisions_hash(in_conflict, agents, num_agents, cell_hash);
+         }
+         else if (engine == "verlet") {
+             neighbor_list->refresh(agents, num_agents);
+             PROFILE_MARK(phase_refresh);
+             detect_collisions_verlet(colliders, agents, num_agents, neighbor_list);
+             if (check_neighbors) {
+                 check_verlet_colliders(colliders, agents, num_agents, grid, iteration_count);
              }
          }
+         else if (engine == "leaves") {
+             update_quadtree(agents, num_agents, agent_leaves, qt, quadtree_refresh);
+             quadtree_refresh.end_step();
+             PROFILE_MARK(phase_refresh);
+             detect_collisions_leaves(colliders, agents, num_agents, qt, leaf_index);
+         }
+         else {
+             update_quadtree(agents, num_agents, agent_leaves, qt, quadtree_refresh);
+             quadtree_refresh.end_step();
+             PROFILE_MARK(phase_refresh);
+             if (active_set != nullptr) {
+                 active_checked += active_set->active.size();
+                 detect_collisions_active(colliders, agents, active_set->active, qt);
+             }
+             else {
+                 detect_collisions(colliders, agents, num_agents, qt);
+             }
+         }
+         PROFILE_MARK(phase_detect);
+         double detect_cost = omp_get_wtime() - detect_start;
 
-         std::vector<int> colliders(num_agents, -1);
-         detect_collisions(colliders, agents, num_agents, qt);
-         resolve_collisions(colliders, agents, num_agents, dim_x, dim_y);
+         #pragma omp parallel
+         {
+             PROFILE_THREAD_BEGIN();
+             if (flagged) {
+                 kernels.resolve_conflicts_team(in_conflict, agents, num_agents, dim_x, dim_y);
+             }
+             else if (active_set != nullptr) {
+                 kernels.resolve_collisions_active_team(colliders, agents, active_set->active, dim_x, dim_y);
+             }
+             else {
+                 kernels.resolve_collisions_team(colliders, agents, num_agents, dim_x, dim_y);
+             }
+             PROFILE_THREAD_END(phase_resolve);
+         }
+         PROFILE_MARK(phase_resolve);
 
-         #pragma omp parallel for schedule(dynamic)
-         for(int i = 0; i < num_agents; i++) {
-             agents[i].x_pos = agents[i].next_x;
-             agents[i].y_pos = agents[i].next_y;
+         #pragma omp parallel
+         {
+             PROFILE_THREAD_BEGIN();
+             #pragma omp for schedule(dynamic) nowait
+             for(int i = 0; i < num_agents; i++) {
+                 agents[i].x_pos = agents[i].next_x;
+                 agents[i].y_pos = agents[i].next_y;
+             }
+             PROFILE_THREAD_END(phase_commit);
+         }
+         PROFILE_MARK(phase_commit);
+         if (active_set != nullptr) {
+             active_set->update(agents, num_agents);
+             PROFILE_MARK(phase_upkeep);
          }
+         PROFILE_STEP_END();
 
+         // a new depth limit only applies to nodes as they split, so rebuild
+         if (split_tuner != nullptr && split_tuner->after_step(qt, num_agents, detect_cost)) {
+             qt->reset();
+             qt->bulk_load(agents, num_agents, agent_leaves);
+         }
 
          iteration_count += 1;
    
@@ -501,8 +2120,59 @@ void detect_collisions(std::vector<int>& colliders, std::vector<Agent>& agents,
          }
      }
 
+     // back to file order
+     if (reordered) {
+         std::vector<Agent> file_order(num_agents);
+         #pragma omp parallel for schedule(static)
+         for (int i = 0; i < num_agents; i++) {
+             file_order[original_id[i]] = agents[i];
+             file_order[original_id[i]].id = original_id[i];
+         }
+         agents.swap(file_order);
+     }
+
      delete qt;
+     delete grid;
+     delete lqt;
+     delete cqt;
+     delete bitmap;
+     delete cell_sort;
+     delete cell_hash;
+     delete split_tuner;
      
      const double compute_time = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - compute_start).count();
      std::cout << "Computation time (sec): " << compute_time << '\n';
+     if (!output_filename.empty() && !write_agents(output_filename, dim_x, dim_y, agents)) {
+         std::cerr << "Unable to write file: " << output_filename << ".\n";
+         exit(EXIT_FAILURE);
+     }
+     if (tuner != "off") {
+         std::cout << "Quadtree split: max_agents " << max_agents << ", max_depth " << max_depth << '\n';
+     }
+     if (neighbor_list != nullptr) {
+         std::cout << "Neighbor lists: radius " << neighbor_list->radius << ", rebuilt " << neighbor_list->rebuilds
+                   << " times, " << std::setprecision(1) << (double)neighbor_list->neighbors.size() / std::max(num_agents, 1)
+                   << " candidates per agent\n";
+         if (check_neighbors) {
+             std::cout << "Neighbor list check passed\n";
+         }
+         delete neighbor_list;
+     }
+     if (active_set != nullptr) {
+         std::cout << "Active set: " << std::setprecision(1) << (double)active_checked / num_iterations
+                   << " of " << num_agents << " agents checked per step\n";
+         delete active_set;
+     }
+     if (mode == "events") {
+         long long total = (long long)num_agents * num_iterations;
+         std::cout << "Agent-steps stepped: " << event_summary.stepped << " of " << total << " ("
+                   << std::setprecision(1) << 100.0 * event_summary.stepped / std::max(total, 1ll) << "%), "
+                   << event_summary.sleeps << " fast-forwards\n";
+     }
+     if (quadtree_refresh.steps > 0) {
+         std::cout << "Quadtree migrations: " << quadtree_refresh.total << " in " << quadtree_refresh.steps << " steps, "
+                   << std::setprecision(1) << (double)quadtree_refresh.total / quadtree_refresh.steps << " per step, at most "
+                   << quadtree_refresh.most << '\n';
+     }
+     PROFILE_DUMP();
    }
\ No newline at end of file
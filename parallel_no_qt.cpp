@@ -20,11 +20,16 @@
   #include <cstdlib>
   #include <ctime>
   #include <climits>
+  #include <tuple>
    
   #include <unistd.h>
   #include <omp.h>
-  /* Uncomment the following line to use the simulation
-  #include <SDL2/SDL.h> */
+  #include "rng.h"
+  #include "scenario.h"
+  // build with make VISUALIZE=1 to use the simulation
+  #ifdef VISUALIZE
+  #include <SDL2/SDL.h>
+  #endif
   
   const int WINDOW_WIDTH = 800;
   const int WINDOW_HEIGHT = 800;
@@ -141,7 +146,7 @@
   
   
   // assuming no collisions
-  void move_agent(int agent_id, Agent &agent, int dimX, int dimY, std::mt19937 generator) { 
+  void move_agent(int agent_id, Agent &agent, int dimX, int dimY, uint64_t seed, int step) { 
       int currX = agent.x_pos;
       int currY = agent.y_pos;
   
@@ -152,12 +157,10 @@
   
       // N E S W
       // 0 1 2 3
-      std::uniform_int_distribution<int> dist_2(0, 1);
-      std::uniform_int_distribution<int> dist_3(0, 2);
   
       if(currX == 0 && currY == 0){ // top left
           // only options are E and S
-          int next_dir = dist_2(generator); 
+          int next_dir = corner_coin(seed, agent_id, step); 
           if (next_dir == 0){
               direction = 1;
           }
@@ -167,7 +170,7 @@
       } 
       else if (currX == dimX-1 && currY == 0){ // top right
           // only options are S and W
-          int next_dir = dist_2(generator); 
+          int next_dir = corner_coin(seed, agent_id, step); 
           if (next_dir == 0) {
               direction = 2;
           }
@@ -177,7 +180,7 @@
       }
       else if (currX == 0 && currY == dimY-1){ // bottom left
            // only options are N and E
-          int next_dir = dist_2(generator); 
+          int next_dir = corner_coin(seed, agent_id, step); 
           if (next_dir == 0) {
               direction = 0;
           }
@@ -187,7 +190,7 @@
       }
       else if (currX == dimX-1 && currY == dimY-1 ){ // bottom right
           // only options are N and W
-          int next_dir = dist_2(generator);
+          int next_dir = corner_coin(seed, agent_id, step);
           if (next_dir == 0) {
               direction = 0;
           }
@@ -234,7 +237,7 @@
       return;
   }
   
-  /* Uncomment the following section to use the simulation 
+  #ifdef VISUALIZE
 
   void render_agents(SDL_Renderer* renderer, const std::vector<Agent>& agents, int dim_x, int dim_y, const std::vector<std::tuple<int, int, int>>& agent_colors) {
       SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255); // white background
@@ -257,7 +260,7 @@
   }
   
   
-   void visualize_simulation(std::vector<Agent>& agents, int dim_x, int dim_y, int num_agents, int num_iterations,  const std::vector<std::tuple<int, int, int>>& agent_colors, std::vector<omp_lock_t>& agent_locks) {
+   void visualize_simulation(std::vector<Agent>& agents, int dim_x, int dim_y, int num_agents, int num_iterations, uint64_t seed, const std::vector<std::tuple<int, int, int>>& agent_colors, std::vector<omp_lock_t>& agent_locks) {
       SDL_Init(SDL_INIT_VIDEO);
       SDL_Window* window = SDL_CreateWindow("Crowd Simulation",
                                             SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
@@ -279,14 +282,10 @@
                   quit = true;
           }
   
-          #pragma omp parallel
-        {
-            std::mt19937 generator(std::random_device{}() + omp_get_thread_num());
-            #pragma omp for
-            for (int i = 0; i < num_agents; i++) {
-                move_agent(i, agents[i], dim_x, dim_y, generator);
-            }
-        }
+          #pragma omp parallel for
+          for (int i = 0; i < num_agents; i++) {
+              move_agent(i, agents[i], dim_x, dim_y, seed, iteration_count);
+          }
   
           check_collisions(agents, num_agents, dim_x, dim_y, agent_locks);
           update_positions(agents, num_agents);
@@ -304,7 +303,7 @@
       SDL_DestroyWindow(window);
       SDL_Quit();
   }
-  */
+  #endif
   
   
   int main(int argc, char *argv[]) {
@@ -312,11 +311,12 @@
    
       std::string input_filename;
       int num_iterations = 0;
+      uint64_t seed = std::random_device{}();
 
       int num_threads = 0;
   
       int opt;
-      while ((opt = getopt(argc, argv, "f:i:n:")) != -1) {
+      while ((opt = getopt(argc, argv, "f:i:n:s:")) != -1) {
           switch (opt) {
           case 'f':
               input_filename = optarg;
@@ -327,6 +327,9 @@
            case 'n':
               num_threads = atoi(optarg);
               break;
+          case 's':
+              seed = strtoull(optarg, nullptr, 10);
+              break;
           default:
               std::cerr << "Usage: " << argv[0] << " -f input_filename\n";
               exit(EXIT_FAILURE);
@@ -341,26 +344,15 @@
 
       omp_set_num_threads(num_threads);
 
-      std::ifstream fin(input_filename);
+      int dim_x, dim_y;
+      std::vector<Agent> agents;
    
-      if (!fin) {
+      // read the grid dimension and agent information from file (text or binary)
+      if (!load_scenario(input_filename, dim_x, dim_y, agents)) {
           std::cerr << "Unable to open file: " << input_filename << ".\n";
           exit(EXIT_FAILURE);
       }
-   
-      int dim_x, dim_y;
-      int num_agents;
-   
-      // read the grid dimension and agent information from file 
-      fin >> dim_x >> dim_y >> num_agents;
-   
-      std::vector<Agent> agents(num_agents);
-  
-      for (auto& agent : agents) {
-          fin >> agent.x_pos >> agent.y_pos >> agent.dir;
-          agent.next_x = agent.x_pos;
-          agent.next_y = agent.y_pos;
-      }
+      int num_agents = (int)agents.size();
   
       std::vector<std::tuple<int, int, int>> agent_colors;
   
@@ -368,13 +360,13 @@
       std::mt19937 gen(rd());
       std::uniform_int_distribution<> color_dist(0, 255);
 
-      /* Uncomment the following section to use the simulation
+      #ifdef VISUALIZE
       for (int i = 0; i < num_agents; i++) {
           agent_colors.push_back({
               color_dist(gen), color_dist(gen), color_dist(gen)
           });
       }
-      */
+      #endif
 
       std::vector<omp_lock_t> agent_locks(num_agents);
 
@@ -389,17 +381,16 @@
   
       int iteration_count = 0;
   
-      /* Uncomment the following line and comment the while loop to use the simulation 
-      visualize_simulation(agents, dim_x, dim_y, num_agents, num_iterations, agent_colors, agent_locks); */
+      // the visualization runs its own loop, so skip the timed one
+      #ifdef VISUALIZE
+      visualize_simulation(agents, dim_x, dim_y, num_agents, num_iterations, seed, agent_colors, agent_locks);
+      iteration_count = num_iterations;
+      #endif
   
       while (iteration_count < num_iterations) {
-            #pragma omp parallel
-            {
-                std::mt19937 generator(std::random_device{}() + omp_get_thread_num());
-                #pragma omp for
-                for (int i = 0; i < num_agents; i++) {
-                    move_agent(i, agents[i], dim_x, dim_y, generator);
-                }
+            #pragma omp parallel for
+            for (int i = 0; i < num_agents; i++) {
+                move_agent(i, agents[i], dim_x, dim_y, seed, iteration_count);
             }
   
           check_collisions(agents, num_agents, dim_x, dim_y, agent_locks);
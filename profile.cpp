@@ -0,0 +1,95 @@
+/**
+ * Phase Profiler
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #include "profile.h"
+
+ #ifdef PROFILE_PHASES
+
+ #include <algorithm>
+ #include <cmath>
+ #include <fstream>
+ #include <iomanip>
+ #include <iostream>
+
+ PhaseProfiler phase_profiler;
+
+ static const char *phase_names[num_phases] = {"move", "refresh", "detect", "resolve", "commit", "upkeep"};
+
+ void PhaseProfiler::init(int num_threads) {
+     busy.assign(num_threads, ThreadTimes{});
+ }
+
+ void PhaseProfiler::add_to_histogram(int row, double seconds) {
+     double us = seconds * 1e6;
+     int bucket = (us < 1.0) ? 0 : std::min(num_buckets - 1, (int)std::log2(us));
+     histogram[row][bucket]++;
+ }
+
+ // thread_file has one row per phase and thread:
+ //     phase,thread,busy_sec,wall_sec
+ // step_file has one row per latency bucket with a count column for every
+ // phase and one for the whole step.
+ // migration_file has one row per step of the quadtree engines:
+ //     step,migrated
+ // and is only written when there are any.
+ bool PhaseProfiler::write_csv(const std::string& thread_file, const std::string& step_file,
+                               const std::string& migration_file) const {
+     std::ofstream threads_out(thread_file);
+     std::ofstream steps_out(step_file);
+     if (!threads_out || !steps_out) {
+         std::cerr << "Unable to write profile files.\n";
+         return false;
+     }
+
+     threads_out << "phase,thread,busy_sec,wall_sec\n" << std::fixed << std::setprecision(9);
+     for (int p = 0; p < num_phases; p++) {
+         for (size_t t = 0; t < busy.size(); t++) {
+             threads_out << phase_names[p] << "," << t << "," << busy[t].seconds[p] << "," << wall[p] << "\n";
+         }
+     }
+
+     // drop the empty buckets above the slowest recorded latency
+     int last = 0;
+     for (int row = 0; row <= num_phases; row++) {
+         for (int b = 0; b < num_buckets; b++) {
+             if (histogram[row][b] != 0) {
+                 last = std::max(last, b);
+             }
+         }
+     }
+
+     steps_out << "bucket_lo_us,bucket_hi_us";
+     for (int p = 0; p < num_phases; p++) {
+         steps_out << "," << phase_names[p];
+     }
+     steps_out << ",step\n";
+     for (int b = 0; b <= last; b++) {
+         steps_out << (b == 0 ? 0LL : (1LL << b)) << "," << (1LL << (b + 1));
+         for (int row = 0; row <= num_phases; row++) {
+             steps_out << "," << histogram[row][b];
+         }
+         steps_out << "\n";
+     }
+
+     if (!migrations.empty()) {
+         std::ofstream migrations_out(migration_file);
+         if (!migrations_out) {
+             std::cerr << "Unable to write profile files.\n";
+             return false;
+         }
+         migrations_out << "step,migrated\n";
+         for (size_t step = 0; step < migrations.size(); step++) {
+             migrations_out << step << "," << migrations[step] << "\n";
+         }
+         std::cout << "Profiled " << num_steps << " steps, wrote " << thread_file << ", " << step_file
+                   << " and " << migration_file << "\n";
+         return true;
+     }
+
+     std::cout << "Profiled " << num_steps << " steps, wrote " << thread_file << " and " << step_file << "\n";
+     return true;
+ }
+
+ #endif
@@ -0,0 +1,108 @@
+/**
+ * Phase Profiler (Header file)
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #ifndef PROFILE_H
+ #define PROFILE_H
+
+ #include <string>
+ #include <vector>
+ #include <omp.h>
+
+ enum Phase {
+     phase_move,
+     phase_refresh,
+     phase_detect,
+     phase_resolve,
+     phase_commit,
+     phase_upkeep, // ActiveSet::update after the commit, only with -t
+     num_phases
+ };
+
+ // Build with make PROFILE=1 to compile the PROFILE_* hooks in. Without it
+ // every hook expands to nothing.
+ #ifdef PROFILE_PHASES
+
+ // Per-phase wall time of the main loop, per-thread busy time inside the
+ // instrumented parallel loops, and log2 histograms of phase and step
+ // latencies. Busy time runs from a thread entering the region to it finishing
+ // its share of the loop, so a thread with a low busy time next to a high
+ // wall time spent that gap waiting at the barrier.
+ class PhaseProfiler {
+     public:
+         // bucket b counts latencies in [2^b, 2^(b+1)) microseconds
+         static const int num_buckets = 32;
+
+         void init(int num_threads);
+
+         // phases are closed by mark(), each one running from the previous mark
+         void step_begin() {
+             step_start = last_mark = omp_get_wtime();
+         }
+         void mark(Phase phase) {
+             double now = omp_get_wtime();
+             wall[phase] += now - last_mark;
+             add_to_histogram(phase, now - last_mark);
+             last_mark = now;
+         }
+         void step_end() {
+             add_to_histogram(num_phases, omp_get_wtime() - step_start);
+             num_steps++;
+         }
+
+         void add_thread_time(Phase phase, int thread, double seconds) {
+             if (thread < (int)busy.size()) {
+                 busy[thread].seconds[phase] += seconds;
+             }
+         }
+
+         // agents the quadtree refresh moved between leaves, one entry per step
+         void add_migrations(int count) {
+             migrations.push_back(count);
+         }
+
+         bool write_csv(const std::string& thread_file, const std::string& step_file,
+                        const std::string& migration_file) const;
+
+     private:
+         // one cache line per thread so the threads do not share counters
+         struct alignas(64) ThreadTimes {
+             double seconds[num_phases];
+         };
+
+         std::vector<ThreadTimes> busy;
+         double wall[num_phases] = {};
+         long long histogram[num_phases + 1][num_buckets] = {};
+         long long num_steps = 0;
+         std::vector<int> migrations;
+         double step_start = 0, last_mark = 0;
+
+         void add_to_histogram(int row, double seconds);
+ };
+
+ extern PhaseProfiler phase_profiler;
+
+ #define PROFILE_INIT(num_threads) phase_profiler.init(num_threads)
+ #define PROFILE_STEP_BEGIN() phase_profiler.step_begin()
+ #define PROFILE_MARK(phase) phase_profiler.mark(phase)
+ #define PROFILE_STEP_END() phase_profiler.step_end()
+ #define PROFILE_THREAD_BEGIN() const double profile_thread_start = omp_get_wtime()
+ #define PROFILE_THREAD_END(phase) phase_profiler.add_thread_time(phase, omp_get_thread_num(), omp_get_wtime() - profile_thread_start)
+ #define PROFILE_MIGRATIONS(count) phase_profiler.add_migrations(count)
+ #define PROFILE_DUMP() phase_profiler.write_csv("profile_threads.csv", "profile_steps.csv", "profile_migrations.csv")
+
+ #else
+
+ #define PROFILE_INIT(num_threads)
+ #define PROFILE_STEP_BEGIN()
+ #define PROFILE_MARK(phase)
+ #define PROFILE_STEP_END()
+ #define PROFILE_THREAD_BEGIN()
+ #define PROFILE_THREAD_END(phase)
+ #define PROFILE_MIGRATIONS(count)
+ #define PROFILE_DUMP()
+
+ #endif
+
+ #endif
@@ -0,0 +1,134 @@
+/**
+ * Quadtree Contention Benchmark
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ *
+ * Builds the locked Quadtree and the lock-free ConcurrentQuadtree from the
+ * same agents at 1 to max_threads threads, then times a remove/insert churn
+ * pass where every agent leaves and re-enters the tree.
+ */
+
+ #include <algorithm>
+ #include <iostream>
+ #include <fstream>
+ #include <iomanip>
+ #include <chrono>
+ #include <string>
+ #include <vector>
+
+ #include <unistd.h>
+ #include <omp.h>
+ #include "quadtree.h"
+ #include "concurrent_quadtree.h"
+ #include "scenario.h"
+
+ double seconds_since(std::chrono::steady_clock::time_point start) {
+     return std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start).count();
+ }
+
+ void bench_locked(std::vector<Agent>& agents, int num_agents, int dim_x, int dim_y, double& build_time, double& churn_time) {
+     std::vector<LeafSet> agent_leaves(num_agents);
+     Quadtree *qt = new Quadtree(0, 0, dim_x-1, dim_y-1, 0);
+
+     auto start = std::chrono::steady_clock::now();
+     #pragma omp parallel for schedule(dynamic, 64)
+     for (int i = 0; i < num_agents; i++) {
+         qt->multiInsert(&agents[i], agent_leaves);
+     }
+     build_time = seconds_since(start);
+
+     start = std::chrono::steady_clock::now();
+     #pragma omp parallel for schedule(dynamic, 64)
+     for (int i = 0; i < num_agents; i++) {
+         qt->multiRemove(&agents[i]);
+         agent_leaves[i].clear();
+         qt->multiInsert(&agents[i], agent_leaves);
+     }
+     churn_time = seconds_since(start);
+
+     delete qt;
+ }
+
+ void bench_concurrent(std::vector<Agent>& agents, int num_agents, int dim_x, int dim_y, double& build_time, double& churn_time) {
+     ConcurrentQuadtree *cqt = new ConcurrentQuadtree(0, 0, dim_x-1, dim_y-1, 0);
+
+     auto start = std::chrono::steady_clock::now();
+     #pragma omp parallel for schedule(dynamic, 64)
+     for (int i = 0; i < num_agents; i++) {
+         cqt->insert(&agents[i]);
+     }
+     build_time = seconds_since(start);
+
+     start = std::chrono::steady_clock::now();
+     #pragma omp parallel for schedule(dynamic, 64)
+     for (int i = 0; i < num_agents; i++) {
+         cqt->remove(&agents[i]);
+         cqt->insert(&agents[i]);
+     }
+     churn_time = seconds_since(start);
+
+     delete cqt;
+ }
+
+ int main(int argc, char *argv[]) {
+     std::string input_filename;
+     int max_threads = 64;
+     int repeats = 3;
+
+     int opt;
+     while ((opt = getopt(argc, argv, "f:m:r:")) != -1) {
+         switch (opt) {
+         case 'f':
+             input_filename = optarg;
+             break;
+         case 'm':
+             max_threads = atoi(optarg);
+             break;
+         case 'r':
+             repeats = atoi(optarg);
+             break;
+         default:
+             std::cerr << "Usage: " << argv[0] << " -f input_filename [-m max_threads] [-r repeats]\n";
+             exit(EXIT_FAILURE);
+         }
+     }
+
+     if (empty(input_filename) || max_threads <= 0 || repeats <= 0) {
+         std::cerr << "Usage: " << argv[0] << " -f input_filename [-m max_threads] [-r repeats]\n";
+         exit(EXIT_FAILURE);
+     }
+
+     int dim_x, dim_y;
+     std::vector<Agent> agents;
+     if (!load_scenario(input_filename, dim_x, dim_y, agents)) {
+         std::cerr << "Unable to open file: " << input_filename << ".\n";
+         exit(EXIT_FAILURE);
+     }
+     int num_agents = (int)agents.size();
+     for (int i = 0; i < num_agents; i++) {
+         agents[i].id = i;
+     }
+
+     std::cout << "threads,locked_build,concurrent_build,locked_churn,concurrent_churn\n";
+     std::cout << std::fixed << std::setprecision(6);
+
+     for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+         omp_set_num_threads(num_threads);
+
+         // best of several runs, the first touch of the allocator is noisy
+         double locked_build = 1e30, locked_churn = 1e30;
+         double concurrent_build = 1e30, concurrent_churn = 1e30;
+         for (int r = 0; r < repeats; r++) {
+             double build, churn;
+             bench_locked(agents, num_agents, dim_x, dim_y, build, churn);
+             locked_build = std::min(locked_build, build);
+             locked_churn = std::min(locked_churn, churn);
+
+             bench_concurrent(agents, num_agents, dim_x, dim_y, build, churn);
+             concurrent_build = std::min(concurrent_build, build);
+             concurrent_churn = std::min(concurrent_churn, churn);
+         }
+
+         std::cout << num_threads << "," << locked_build << "," << concurrent_build << ","
+                   << locked_churn << "," << concurrent_churn << "\n";
+     }
+ }
@@ -17,45 +17,99 @@
  #include <ctime>
  #include <climits>
  #include <memory>  
+ #include <new>
     
  #include <unistd.h>
  #include <omp.h>
  #include "quadtree.h"
  
  int Quadtree::next_id = 0;
- 
+
+ // subtrees with fewer agents than this are built by the task that split them,
+ // and nodes are partitioned in chunks of bulk_chunk agents per task
+ const int bulk_task_cutoff = 2048;
+ const int bulk_chunk = 16384;
+ int max_agents = 4;
+ int max_depth = 5;
+ 
+ QuadtreeArena::QuadtreeArena(): num_chunks(0), next_node(0) {
+     chunks = new Quadtree*[max_chunks];
+     omp_init_lock(&lock);
+ }
+
+ QuadtreeArena::~QuadtreeArena() {
+     for (int i = 0; i < num_chunks; i++) {
+         delete[] chunks[i];
+     }
+     delete[] chunks;
+     omp_destroy_lock(&lock);
+ }
+
+ // nodes are only ever constructed once, when their chunk is created
+ int QuadtreeArena::alloc_children() {
+     omp_set_lock(&lock);
+
+     int first;
+     if (!free_list.empty()) {
+         first = free_list.back();
+         free_list.pop_back();
+     }
+     else {
+         if (next_node == num_chunks * chunk_nodes) {
+             if (num_chunks == max_chunks) {
+                 omp_unset_lock(&lock);
+                 throw std::bad_alloc();
+             }
+             chunks[num_chunks++] = new Quadtree[chunk_nodes];
+         }
+         first = next_node;
+         next_node += 4;
+     }
+
+     omp_unset_lock(&lock);
+     return first;
+ }
+
+ void QuadtreeArena::free_children(int first) {
+     omp_set_lock(&lock);
+     free_list.push_back(first);
+     omp_unset_lock(&lock);
+ }
+
+ void QuadtreeArena::reset() {
+     omp_set_lock(&lock);
+     next_node = 0;
+     free_list.clear();
+     omp_unset_lock(&lock);
+ }
+
+ void Quadtree::init(int min_x, int min_y, int max_x, int max_y, int depth, QuadtreeArena *arena) {
+     this->min_x = min_x;
+     this->min_y = min_y;
+     this->max_x = max_x;
+     this->max_y = max_y;
+     this->depth = depth;
+     this->arena = arena;
+     first_child.store(-1, std::memory_order_relaxed);
+     agents.clear();
+
+     #pragma omp atomic capture
+     id = next_id++;
+ }
+
  void Quadtree::split() {
      int midX = (min_x + max_x) / 2;
      int midY = (min_y + max_y) / 2;
-  
-     #pragma omp parallel sections 
-     {
-         #pragma omp section 
-         {
-             children[0] = std::make_unique<Quadtree>(min_x,min_y, midX, midY, depth + 1);
-         }
- 
-         #pragma omp section 
-         {
-             children[1] = std::make_unique<Quadtree>(midX, min_y, max_x, midY, depth + 1);
-        }
- 
-         #pragma omp section 
-         {
-             children[2] = std::make_unique<Quadtree>(min_x, midY, midX, max_y, depth + 1);
-        }
-         
-         #pragma omp section 
-         {
-             children[3] = std::make_unique<Quadtree>(midX, midY, max_x, max_y, depth + 1);
-         }
-    }
-     children[0]->id = Quadtree::next_id++;
-     children[1]->id = Quadtree::next_id++;
-     children[2]->id = Quadtree::next_id++;
-     children[3]->id = Quadtree::next_id++;
+
+     int first = arena->alloc_children();
+     arena->node(first)->init(min_x, min_y, midX, midY, depth + 1, arena);
+     arena->node(first + 1)->init(midX, min_y, max_x, midY, depth + 1, arena);
+     arena->node(first + 2)->init(min_x, midY, midX, max_y, depth + 1, arena);
+     arena->node(first + 3)->init(midX, midY, max_x, max_y, depth + 1, arena);
+
+     // publish the block only once all four children are set up
+     first_child.store(first, std::memory_order_release);
  }
- 
    
  int Quadtree::getQuadrant(Agent &agent) {
      int midX = (min_x + max_x) / 2;
@@ -81,41 +135,52 @@
      return -1;
  }
  
- std::vector<int> Quadtree::getMultiQuadrant(const Agent &agent) {
+ // bit q is set for every quadrant q the agent belongs to; agents within
+ // the margin of the midlines go to both sides. With reach > 0, the quadrants
+ // of every position up to reach cells away.
+ int Quadtree::multi_quadrant_mask(const Agent &agent, int reach) const {
      int midX = (min_x + max_x) / 2;
      int midY = (min_y + max_y) / 2;
- 
+
+     bool top = agent.y_pos - reach <= midY + 2;
+     bool bottom = agent.y_pos + reach >= midY - 1;
+     bool right = agent.x_pos + reach >= midX - 1;
+     bool left = agent.x_pos - reach <= midX + 2;
+
+     return (top && left) | ((top && right) << 1) | ((bottom && left) << 2) | ((bottom && right) << 3);
+ }
+
+ std::vector<int> Quadtree::getMultiQuadrant(const Agent &agent) {
+     int mask = multi_quadrant_mask(agent);
+
      std::vector<int> possible_quadrants;
- 
-     bool top = agent.y_pos <= midY + 2;
-     bool bottom = agent.y_pos >= midY - 1;
-     bool right = agent.x_pos >= midX - 1;
-     bool left = agent.x_pos <= midX + 2;
- 
-     if (top && left) { 
-         possible_quadrants.push_back(0);
-     }
-     if (top && right) { 
-         possible_quadrants.push_back(1);
-     }
-     if (bottom && left) { 
-         possible_quadrants.push_back(2);
-     }
-     if (bottom && right) {
-         possible_quadrants.push_back(3);
+     for (int q = 0; q < 4; q++) {
+         if (mask & (1 << q)) {
+             possible_quadrants.push_back(q);
+         }
      }
      return possible_quadrants;
  }
  
+ // Resetting the root drops the whole tree in O(1): the arena just forgets
+ // its blocks and the nodes are set up again when they are handed back out.
+ // A subtree returns its blocks to the free list instead.
  void Quadtree::reset() {
      agents.clear();
-     #pragma omp parallel for
-     for(int i = 0; i < 4; i++){
-         if (children[i] != nullptr) {
-             children[i]->reset();  
-             children[i].reset(); 
+     if (is_leaf()) {
+         return;
+     }
+
+     if (arena == owned_arena.get()) {
+         arena->reset();
+     }
+     else {
+         for (int i = 0; i < 4; i++) {
+             child(i)->reset();
          }
+         arena->free_children(first_child.load(std::memory_order_relaxed));
      }
+     first_child.store(-1, std::memory_order_relaxed);
  }
  
  
@@ -123,9 +188,9 @@
      int index = -1;
      Quadtree *curr = this;
  
-     while (curr->children[0] != nullptr){
+     while (!curr->is_leaf()){
          index = curr->getQuadrant(agent);
-         curr = curr->children[index].get();
+         curr = curr->child(index);
      }
      return curr;  
  }
@@ -137,18 +202,20 @@
  }
  
  
+ // The agent was inserted from where it stood when it last moved leaves,
+ // and agents move one cell per step, so its old leaves are among those
+ // reached from one cell around where it is now. Walking from the current
+ // position alone left the agent behind in every leaf it walked out of.
  void Quadtree::multiRemove(Agent *agent) {
      omp_set_lock(&lock);
  
-     if (children[0] != nullptr) { 
-         std::vector<int> indices = getMultiQuadrant(*agent);
+     if (!is_leaf()) { 
+         int mask = multi_quadrant_mask(*agent, 1);
          omp_unset_lock(&lock);
  
-         if (!indices.empty()) {
-             for (auto index: indices) {
-                 if (children[index]) {
-                     children[index]->multiRemove(agent);
-                 }
+         for (int q = 0; q < 4; q++) {
+             if (mask & (1 << q)) {
+                 child(q)->multiRemove(agent);
              }
          }
          return;
@@ -164,31 +231,45 @@
      omp_unset_lock(&lock);
  }
  
- void Quadtree::get_leaf_nodes(Agent& agent, std::vector<int>& leaves) {
-     if (children[0] == nullptr) { // this is a leaf
-         leaves.push_back(this->id);
+ void Quadtree::get_leaf_nodes(Agent& agent, LeafSet& leaves) {
+     if (is_leaf()) {
+         leaves.add(this->id);
          return;
      }
  
-     std::vector<int> indices = getMultiQuadrant(agent);
- 
-     for (int index : indices) {
-         if (children[index]) {
-             children[index]->get_leaf_nodes(agent, leaves);
+     int mask = multi_quadrant_mask(agent);
+
+     // keep the box to positions that give the same mask: each side of a
+     // midline is either reached (x <= midX + 2 on the left, x >= midX - 1 on
+     // the right) or not, and one of the two always is
+     int midX = (min_x + max_x) / 2;
+     int midY = (min_y + max_y) / 2;
+     bool left = mask & 0b0101;
+     bool right = mask & 0b1010;
+     bool top = mask & 0b0011;
+     bool bottom = mask & 0b1100;
+     leaves.clip_box(!left ? midX + 3 : (right ? midX - 1 : INT_MIN),
+                     !top ? midY + 3 : (bottom ? midY - 1 : INT_MIN),
+                     !right ? midX - 2 : (left ? midX + 2 : INT_MAX),
+                     !bottom ? midY - 2 : (top ? midY + 2 : INT_MAX));
+
+     for (int q = 0; q < 4; q++) {
+         if (mask & (1 << q)) {
+             child(q)->get_leaf_nodes(agent, leaves);
          }
      }
  }
  
- void Quadtree::multiInsert(Agent *agent, std::vector<std::vector<int>>&  leaves) {
+ void Quadtree::multiInsert(Agent *agent, std::vector<LeafSet>& leaves) {
  
      omp_set_lock(&lock);
  
-     if (children[0] != nullptr) { // not a leaf
+     if (!is_leaf()) {
          std::vector<int> quadrants = getMultiQuadrant(*agent);
  
          if (!quadrants.empty()) {
              for (auto quad: quadrants) {
-                 children[quad]->multiInsert(agent, leaves);
+                 child(quad)->multiInsert(agent, leaves);
              }
          }
          omp_unset_lock(&lock);
@@ -197,24 +278,23 @@
      // lock is still set
  
      agents.push_back(agent);
-     leaves[agent->id].push_back(this->id);
+     leaves[agent->id].add(this->id);
  
-     if (agents.size() > max_agents && depth < max_depth){
-         if(children[0] == nullptr){
+     if ((int)agents.size() > max_agents && depth < max_depth){
+         if(is_leaf()){
              split();
          }
          std::vector<Agent*> agents_to_reinsert = agents;
          agents.clear();
  
          for (Agent* a : agents_to_reinsert) {
-             auto& agent_leaf_ids = leaves[a->id];
-             agent_leaf_ids.erase(std::remove(agent_leaf_ids.begin(), agent_leaf_ids.end(), this->id), agent_leaf_ids.end());
+             leaves[a->id].remove(this->id);
          }
  
          for (Agent* moved : agents_to_reinsert) {
              std::vector<int> quadrants = getMultiQuadrant(*moved);
              for (auto quad : quadrants) {
-                 children[quad]->multiInsert(moved, leaves);
+                 child(quad)->multiInsert(moved, leaves);
              }
          }
          omp_unset_lock(&lock); 
@@ -222,4 +302,110 @@
          return;
      }
      omp_unset_lock(&lock);
- }
\ No newline at end of file
+ }
+
+ // A node splits in multiInsert as soon as more than max_agents agents have
+ // reached it, and agents are only ever added, so the final tree only depends
+ // on how many agents reach each node. Counting them top down gives the same
+ // nodes without any locking or reinserting.
+ //
+ // An agent that only ever fell into one quadrant lives in exactly one leaf,
+ // which records it right away. Agents in the margins are marked in shared
+ // and looked up once the tree is complete, since several tasks may reach
+ // their leaves at the same time.
+ void Quadtree::bulk_build(std::vector<Agent*>& list, std::vector<LeafSet>& leaves, std::vector<char>& shared) {
+     int n = (int)list.size();
+     if (n <= max_agents || depth >= max_depth) {
+         agents.swap(list);
+         for (Agent *a : agents) {
+             if (!shared[a->id]) {
+                 leaves[a->id].add(id);
+             }
+         }
+         return;
+     }
+
+     split();
+
+     // Count every chunk's agents per quadrant, then let each chunk write its
+     // agents at its own offsets, so the big nodes near the root are split up
+     // by several tasks and every list is allocated once at its final size.
+     int num_chunks = (n + bulk_chunk - 1) / bulk_chunk;
+     std::vector<unsigned char> masks(n);
+     std::vector<std::array<int, 4>> offsets(num_chunks);
+
+     // locals of a task would be firstprivate in the tasks it creates
+     #pragma omp taskloop if(num_chunks > 1) shared(list, masks, offsets, shared)
+     for (int c = 0; c < num_chunks; c++) {
+         std::array<int, 4> count = {0, 0, 0, 0};
+         int end = std::min(n, (c + 1) * bulk_chunk);
+         for (int i = c * bulk_chunk; i < end; i++) {
+             int mask = multi_quadrant_mask(*list[i]);
+             masks[i] = (unsigned char)mask;
+             for (int q = 0; q < 4; q++) {
+                 count[q] += (mask >> q) & 1;
+             }
+             if (mask & (mask - 1)) {
+                 #pragma omp atomic write
+                 shared[list[i]->id] = 1;
+             }
+         }
+         offsets[c] = count;
+     }
+
+     std::vector<Agent*> parts[4];
+     for (int q = 0; q < 4; q++) {
+         int total = 0;
+         for (int c = 0; c < num_chunks; c++) {
+             int count = offsets[c][q];
+             offsets[c][q] = total;
+             total += count;
+         }
+         parts[q].resize(total);
+     }
+
+     #pragma omp taskloop if(num_chunks > 1) shared(list, masks, offsets, parts)
+     for (int c = 0; c < num_chunks; c++) {
+         std::array<int, 4> next = offsets[c];
+         int end = std::min(n, (c + 1) * bulk_chunk);
+         for (int i = c * bulk_chunk; i < end; i++) {
+             for (int q = 0; q < 4; q++) {
+                 if ((masks[i] >> q) & 1) {
+                     parts[q][next[q]++] = list[i];
+                 }
+             }
+         }
+     }
+     std::vector<Agent*>().swap(list);
+
+     for (int q = 0; q < 4; q++) {
+         Quadtree *kid = child(q);
+         std::vector<Agent*> *part = &parts[q];
+         #pragma omp task if((int)part->size() > bulk_task_cutoff) firstprivate(kid, part) shared(leaves, shared)
+         kid->bulk_build(*part, leaves, shared);
+     }
+     #pragma omp taskwait
+ }
+
+ void Quadtree::bulk_load(std::vector<Agent>& all_agents, int num_agents, std::vector<LeafSet>& leaves) {
+     std::vector<Agent*> list(num_agents);
+     std::vector<char> shared(num_agents, 0);
+     #pragma omp parallel
+     {
+         #pragma omp for schedule(static)
+         for (int i = 0; i < num_agents; i++) {
+             list[i] = &all_agents[i];
+             leaves[all_agents[i].id].clear();
+         }
+
+         #pragma omp single
+         bulk_build(list, leaves, shared);
+
+         #pragma omp for schedule(dynamic, 256)
+         for (int i = 0; i < num_agents; i++) {
+             if (shared[all_agents[i].id]) {
+                 get_leaf_nodes(all_agents[i], leaves[all_agents[i].id]);
+             }
+         }
+     }
+ }
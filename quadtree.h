@@ -7,17 +7,45 @@
  #define QUADTREE_H
 
  #include <array>
+ #include <atomic>
  #include <vector>
  #include <memory> 
  #include <omp.h>
+ #include "agent.h"
+ #include "leaf_set.h"
 
 
- const int max_agents = 4;
- const int max_depth = 5;
+ // a node splits once it holds more than max_agents, unless it is already at
+ // max_depth; set from main (-a/-d) or by the split tuner, default 4 and 5
+ extern int max_agents;
+ extern int max_depth;
 
- struct Agent {
-    int x_pos, y_pos, dir, next_x, next_y;
-    int id;
+ class Quadtree;
+
+ // Node storage for one tree. The four children of a node are allocated as
+ // one block of consecutive nodes and referred to by the index of the first;
+ // chunks are never moved or freed until the arena goes away. Freed blocks go
+ // on a free list, and reset() forgets every block at once.
+ class QuadtreeArena {
+     public:
+         QuadtreeArena();
+         ~QuadtreeArena();
+
+         int alloc_children();
+         void free_children(int first);
+         void reset();
+
+         Quadtree *node(int index);
+
+     private:
+         static const int chunk_nodes = 4 * 1024;
+         static const int max_chunks = 1 << 16;
+
+         Quadtree **chunks;
+         int num_chunks;
+         int next_node;
+         std::vector<int> free_list;
+         omp_lock_t lock;
  };
   
  class Quadtree {
@@ -32,23 +60,41 @@
  
          std::vector<Agent*> agents;
 
-         std::array<std::unique_ptr<Quadtree>, 4> children;
+         // index of the first of our four children in the arena, -1 for a leaf;
+         // split() publishes it with a release store, so a reader that walks
+         // the tree without the node lock and sees the index also sees the
+         // children's init()
+         std::atomic<int> first_child;
+         QuadtreeArena *arena;
  
         Quadtree(int min_x, int min_y, int max_x, int max_y, int depth):
-        min_x(min_x), min_y(min_y), max_x(max_x), max_y(max_y), depth(depth){
-            for (int i = 0; i < 4; i++) {
-                children[i] = nullptr;
-            }
+        min_x(min_x), min_y(min_y), max_x(max_x), max_y(max_y), depth(depth),
+        first_child(-1), owned_arena(new QuadtreeArena()) {
+            arena = owned_arena.get();
             omp_init_lock(&lock);
 
             #pragma omp atomic capture
             id = next_id++;
         }
 
+        // arena slots, set up by init() when their block is handed out
+        Quadtree(): first_child(-1), arena(nullptr) {
+            omp_init_lock(&lock);
+        }
+
         ~Quadtree() {
             omp_destroy_lock(&lock);
         }
+
+        bool is_leaf() const {
+            return first_child.load(std::memory_order_acquire) < 0;
+        }
+
+        Quadtree *child(int index) const {
+            return arena->node(first_child.load(std::memory_order_acquire) + index);
+        }
         
+        void init(int min_x, int min_y, int max_x, int max_y, int depth, QuadtreeArena *arena);
         void split();
         int getQuadrant(Agent &agent);
         std::vector<int> getMultiQuadrant(const Agent &agent);
@@ -56,8 +102,23 @@
         Quadtree *get_leaf(Agent &agent);
         std::vector<Agent*> collidable_agents();
         void multiRemove(Agent *agent);
-        void multiInsert(Agent *agent, std::vector<std::vector<int>>&  leaves);
-        void get_leaf_nodes(Agent& agent, std::vector<int>& leaves);
+        void multiInsert(Agent *agent, std::vector<LeafSet>& leaves);
+        void get_leaf_nodes(Agent& agent, LeafSet& leaves);
+
+        // Builds the tree multiInsert would build from the agents in one
+        // parallel top-down pass and fills leaves the same way. The node must
+        // be an empty leaf, e.g. new or just reset().
+        void bulk_load(std::vector<Agent>& all_agents, int num_agents, std::vector<LeafSet>& leaves);
+
+     private:
+        std::unique_ptr<QuadtreeArena> owned_arena;
+
+        int multi_quadrant_mask(const Agent &agent, int reach = 0) const;
+        void bulk_build(std::vector<Agent*>& list, std::vector<LeafSet>& leaves, std::vector<char>& shared);
  };
+
+ inline Quadtree *QuadtreeArena::node(int index) {
+     return &chunks[index / chunk_nodes][index % chunk_nodes];
+ }
  
  #endif
\ No newline at end of file
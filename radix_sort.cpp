@@ -0,0 +1,86 @@
+/**
+ * Parallel Radix Sort
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #include <algorithm>
+ #include <cstdint>
+ #include <vector>
+
+ #include <omp.h>
+ #include "radix_sort.h"
+
+ const int radix_bits = 8;
+ const int radix_size = 1 << radix_bits;
+
+ template <typename Key>
+ static void radix_sort_impl(std::vector<Key>& keys, std::vector<int>& values, int key_bits) {
+     int n = (int)keys.size();
+     if (n <= 1 || key_bits <= 0) {
+         return;
+     }
+
+     std::vector<Key> tmp_keys(n);
+     std::vector<int> tmp_values(n);
+     int num_passes = (key_bits + radix_bits - 1) / radix_bits;
+
+     int num_threads = omp_get_max_threads();
+     // counts[t * radix_size + digit], turned into scatter offsets in place
+     std::vector<int> counts((size_t)num_threads * radix_size);
+
+     Key *src_keys = keys.data(), *dst_keys = tmp_keys.data();
+     int *src_values = values.data(), *dst_values = tmp_values.data();
+
+     for (int pass = 0; pass < num_passes; pass++) {
+         int shift = pass * radix_bits;
+
+         #pragma omp parallel num_threads(num_threads)
+         {
+             int t = omp_get_thread_num();
+             int nt = omp_get_num_threads();
+             int begin = (int)((long long)n * t / nt);
+             int end = (int)((long long)n * (t + 1) / nt);
+             int *local = &counts[(size_t)t * radix_size];
+
+             std::fill(local, local + radix_size, 0);
+             for (int i = begin; i < end; i++) {
+                 local[(src_keys[i] >> shift) & (radix_size - 1)]++;
+             }
+
+             #pragma omp barrier
+             #pragma omp single
+             {
+                 int sum = 0;
+                 for (int digit = 0; digit < radix_size; digit++) {
+                     for (int u = 0; u < nt; u++) {
+                         int c = counts[(size_t)u * radix_size + digit];
+                         counts[(size_t)u * radix_size + digit] = sum;
+                         sum += c;
+                     }
+                 }
+             }
+
+             for (int i = begin; i < end; i++) {
+                 int slot = local[(src_keys[i] >> shift) & (radix_size - 1)]++;
+                 dst_keys[slot] = src_keys[i];
+                 dst_values[slot] = src_values[i];
+             }
+         }
+
+         std::swap(src_keys, dst_keys);
+         std::swap(src_values, dst_values);
+     }
+
+     if (src_keys != keys.data()) {
+         std::copy(tmp_keys.begin(), tmp_keys.end(), keys.begin());
+         std::copy(tmp_values.begin(), tmp_values.end(), values.begin());
+     }
+ }
+
+ void radix_sort_pairs(std::vector<uint32_t>& keys, std::vector<int>& values, int key_bits) {
+     radix_sort_impl(keys, values, key_bits);
+ }
+
+ void radix_sort_pairs(std::vector<uint64_t>& keys, std::vector<int>& values, int key_bits) {
+     radix_sort_impl(keys, values, key_bits);
+ }
@@ -0,0 +1,18 @@
+/**
+ * Parallel Radix Sort (Header file)
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #ifndef RADIX_SORT_H
+ #define RADIX_SORT_H
+
+ #include <cstdint>
+ #include <vector>
+
+ // Stable LSD radix sort of (key, value) pairs on the low key_bits bits of the
+ // keys, 8 bits per pass. Every thread histograms and scatters its own
+ // contiguous chunk, so equal keys keep their input order at any thread count.
+ void radix_sort_pairs(std::vector<uint32_t>& keys, std::vector<int>& values, int key_bits);
+ void radix_sort_pairs(std::vector<uint64_t>& keys, std::vector<int>& values, int key_bits);
+
+ #endif
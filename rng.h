@@ -0,0 +1,30 @@
+/**
+ * Counter-Based Random Numbers (Header file)
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #ifndef RNG_H
+ #define RNG_H
+
+ #include <cstdint>
+
+ inline uint64_t splitmix64(uint64_t x) {
+     uint64_t z = x + 0x9E3779B97F4A7C15ull;
+     z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+     z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+     return z ^ (z >> 31);
+ }
+
+ // A draw is a pure function of (seed, agent id, step), so there is no
+ // generator state to seed, copy or share between threads, and the same seed
+ // replays the same moves at any thread count.
+ inline uint64_t counter_rng(uint64_t seed, uint32_t agent_id, uint32_t step) {
+     return splitmix64(splitmix64(seed) ^ (((uint64_t)agent_id << 32) | step));
+ }
+
+ // fair 0/1 draw used to pick between the two exits of a corner
+ inline int corner_coin(uint64_t seed, int agent_id, int step) {
+     return (int)(counter_rng(seed, (uint32_t)agent_id, (uint32_t)step) >> 63);
+ }
+
+ #endif
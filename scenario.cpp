@@ -0,0 +1,162 @@
+/**
+ * Scenario Files
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #include <cstdint>
+ #include <cstring>
+ #include <fstream>
+ #include <iostream>
+ #include <string>
+ #include <vector>
+
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+ #include "scenario.h"
+
+ MappedScenario::~MappedScenario() {
+     if (data != nullptr) {
+         munmap((void*)data, size);
+     }
+ }
+
+ bool MappedScenario::open(const std::string& filename) {
+     int fd = ::open(filename.c_str(), O_RDONLY);
+     if (fd < 0) {
+         return false;
+     }
+
+     struct stat st;
+     if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ScenarioHeader)) {
+         close(fd);
+         return false;
+     }
+
+     size = st.st_size;
+     void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+     close(fd);
+     if (mapped == MAP_FAILED) {
+         size = 0;
+         return false;
+     }
+     data = static_cast<const char*>(mapped);
+     madvise(mapped, size, MADV_SEQUENTIAL);
+
+     ScenarioHeader header;
+     std::memcpy(&header, data, sizeof(header));
+     if (std::memcmp(header.magic, scenario_magic, 4) != 0 || header.version != scenario_version ||
+         header.num_agents > INT32_MAX || sizeof(ScenarioHeader) + header.field_count * sizeof(ScenarioField) > size) {
+         std::cerr << "Malformed scenario file: " << filename << ".\n";
+         return false;
+     }
+
+     // every field has to fit inside the file
+     for (uint32_t k = 0; k < header.field_count; k++) {
+         ScenarioField f;
+         std::memcpy(&f, data + sizeof(ScenarioHeader) + k * sizeof(ScenarioField), sizeof(f));
+         if ((f.elem_size != 1 && f.elem_size != 2 && f.elem_size != 4) ||
+             f.offset > size || header.num_agents * f.elem_size > size - f.offset) {
+             std::cerr << "Malformed scenario file: " << filename << ".\n";
+             return false;
+         }
+     }
+
+     dim_x = (int)header.dim_x;
+     dim_y = (int)header.dim_y;
+     num_agents = (int)header.num_agents;
+     return true;
+ }
+
+ const void *MappedScenario::field(uint32_t kind, uint32_t& elem_size) const {
+     ScenarioHeader header;
+     std::memcpy(&header, data, sizeof(header));
+
+     for (uint32_t k = 0; k < header.field_count; k++) {
+         ScenarioField f;
+         std::memcpy(&f, data + sizeof(ScenarioHeader) + k * sizeof(ScenarioField), sizeof(f));
+         if (f.kind == kind) {
+             elem_size = f.elem_size;
+             return data + f.offset;
+         }
+     }
+     return nullptr;
+ }
+
+ bool is_binary_scenario(const std::string& filename) {
+     std::ifstream fin(filename, std::ios::binary);
+     char magic[4];
+     return fin.read(magic, 4) && std::memcmp(magic, scenario_magic, 4) == 0;
+ }
+
+ template <typename T>
+ static bool write_column(std::ofstream& fout, const std::vector<int>& values) {
+     std::vector<T> column(values.size());
+     for (size_t i = 0; i < values.size(); i++) {
+         column[i] = (T)values[i];
+     }
+     return (bool)fout.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+ }
+
+ static uint32_t narrowest(int max_value) {
+     if (max_value <= UINT8_MAX) {
+         return 1;
+     }
+     return max_value <= UINT16_MAX ? 2 : 4;
+ }
+
+ bool write_scenario_binary(const std::string& filename, int dim_x, int dim_y,
+                            const std::vector<int>& xs, const std::vector<int>& ys, const std::vector<int>& dirs) {
+     std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+     if (!fout) {
+         return false;
+     }
+
+     uint64_t n = xs.size();
+     ScenarioHeader header;
+     std::memcpy(header.magic, scenario_magic, 4);
+     header.version = scenario_version;
+     header.dim_x = dim_x;
+     header.dim_y = dim_y;
+     header.num_agents = n;
+     header.field_count = 3;
+     header.reserved = 0;
+
+     // columns start 64-byte aligned
+     ScenarioField fields[3] = {
+         {field_x, narrowest(dim_x - 1), 0},
+         {field_y, narrowest(dim_y - 1), 0},
+         {field_dir, 1, 0},
+     };
+     uint64_t offset = sizeof(header) + sizeof(fields);
+     for (auto& f : fields) {
+         offset = (offset + 63) / 64 * 64;
+         f.offset = offset;
+         offset += n * f.elem_size;
+     }
+
+     fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+     fout.write(reinterpret_cast<const char*>(fields), sizeof(fields));
+
+     const std::vector<int> *columns[3] = {&xs, &ys, &dirs};
+     for (int k = 0; k < 3; k++) {
+         std::vector<char> padding(fields[k].offset - (uint64_t)fout.tellp(), 0);
+         fout.write(padding.data(), padding.size());
+
+         bool ok;
+         if (fields[k].elem_size == 1) {
+             ok = write_column<uint8_t>(fout, *columns[k]);
+         }
+         else if (fields[k].elem_size == 2) {
+             ok = write_column<uint16_t>(fout, *columns[k]);
+         }
+         else {
+             ok = write_column<uint32_t>(fout, *columns[k]);
+         }
+         if (!ok) {
+             return false;
+         }
+     }
+     return (bool)fout;
+ }
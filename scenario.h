@@ -0,0 +1,144 @@
+/**
+ * Scenario Files (Header file)
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #ifndef SCENARIO_H
+ #define SCENARIO_H
+
+ #include <cstddef>
+ #include <cstdint>
+ #include <fstream>
+ #include <string>
+ #include <vector>
+
+ // Binary scenarios start with a ScenarioHeader, followed by field_count
+ // ScenarioField entries. Each field is a packed array of num_agents unsigned
+ // integers of elem_size bytes starting at offset, so a loader can copy whole
+ // columns straight out of the mapped file. Everything is little endian.
+ const char scenario_magic[4] = {'C', 'R', 'W', 'D'};
+ const uint32_t scenario_version = 1;
+
+ enum ScenarioFieldKind : uint32_t {
+     field_x = 0,
+     field_y = 1,
+     field_dir = 2,
+ };
+
+ struct ScenarioHeader {
+     char magic[4];
+     uint32_t version;
+     uint32_t dim_x, dim_y;
+     uint64_t num_agents;
+     uint32_t field_count;
+     uint32_t reserved;
+ };
+
+ struct ScenarioField {
+     uint32_t kind;
+     uint32_t elem_size;
+     uint64_t offset;
+ };
+
+ // Read-only mmap of a binary scenario. Field pointers stay valid until the
+ // object goes away.
+ class MappedScenario {
+     public:
+         int dim_x = 0, dim_y = 0;
+         int num_agents = 0;
+
+         MappedScenario() = default;
+         ~MappedScenario();
+         MappedScenario(const MappedScenario&) = delete;
+         MappedScenario& operator=(const MappedScenario&) = delete;
+
+         bool open(const std::string& filename);
+         const void *field(uint32_t kind, uint32_t& elem_size) const;
+
+     private:
+         const char *data = nullptr;
+         size_t size = 0;
+ };
+
+ bool is_binary_scenario(const std::string& filename);
+
+ // Writes x, y and dir columns using the narrowest type that fits the grid.
+ bool write_scenario_binary(const std::string& filename, int dim_x, int dim_y,
+                            const std::vector<int>& xs, const std::vector<int>& ys, const std::vector<int>& dirs);
+
+ template <typename T, typename AgentT, typename Set>
+ void copy_column(const void *column, std::vector<AgentT>& agents, Set set) {
+     const T *src = static_cast<const T*>(column);
+     int n = (int)agents.size();
+
+     // serial.cpp includes this without -fopenmp
+     #ifdef _OPENMP
+     #pragma omp parallel for schedule(static)
+     #endif
+     for (int i = 0; i < n; i++) {
+         set(agents[i], (int)src[i]);
+     }
+ }
+
+ template <typename AgentT, typename Set>
+ bool copy_field(const MappedScenario& scenario, uint32_t kind, std::vector<AgentT>& agents, Set set) {
+     uint32_t elem_size;
+     const void *column = scenario.field(kind, elem_size);
+     if (column == nullptr) {
+         return false;
+     }
+     if (elem_size == 1) {
+         copy_column<uint8_t>(column, agents, set);
+     }
+     else if (elem_size == 2) {
+         copy_column<uint16_t>(column, agents, set);
+     }
+     else {
+         copy_column<uint32_t>(column, agents, set);
+     }
+     return true;
+ }
+
+ // Loads either a binary scenario or the original text format
+ //     dim_x dim_y
+ //     num_agents
+ //     x y dir      (one line per agent)
+ // into agents. Fills x_pos, y_pos, dir and sets next_x/next_y to the start
+ // position; anything else (ids, colours) is up to the caller.
+ template <typename AgentT>
+ bool load_scenario(const std::string& filename, int& dim_x, int& dim_y, std::vector<AgentT>& agents) {
+     if (is_binary_scenario(filename)) {
+         MappedScenario scenario;
+         if (!scenario.open(filename)) {
+             return false;
+         }
+         dim_x = scenario.dim_x;
+         dim_y = scenario.dim_y;
+         agents.resize(scenario.num_agents);
+
+         bool ok = copy_field(scenario, field_x, agents, [](AgentT& a, int v) { a.x_pos = a.next_x = v; }) &&
+                   copy_field(scenario, field_y, agents, [](AgentT& a, int v) { a.y_pos = a.next_y = v; }) &&
+                   copy_field(scenario, field_dir, agents, [](AgentT& a, int v) { a.dir = v; });
+         return ok;
+     }
+
+     std::ifstream fin(filename);
+     if (!fin) {
+         return false;
+     }
+
+     int num_agents;
+     if (!(fin >> dim_x >> dim_y >> num_agents) || num_agents < 0) {
+         return false;
+     }
+     agents.resize(num_agents);
+
+     for (auto& agent : agents) {
+         fin >> agent.x_pos >> agent.y_pos >> agent.dir;
+         agent.next_x = agent.x_pos;
+         agent.next_y = agent.y_pos;
+     }
+     return (bool)fin;
+ }
+
+ #endif
@@ -20,9 +20,15 @@ struct Agent {
 #include <cstdlib>
 #include <ctime>
 #include <climits>
+#include <tuple>
  
 #include <unistd.h>
-// #include <SDL2/SDL.h>
+#include "rng.h"
+#include "scenario.h"
+// build with make VISUALIZE=1 to use the simulation
+#ifdef VISUALIZE
+#include <SDL2/SDL.h>
+#endif
 
 const int WINDOW_WIDTH = 800;
 const int WINDOW_HEIGHT = 800;
@@ -128,7 +134,7 @@ void check_collisions(std::vector<Agent>& agents, int num_agents, int dimX, int
 
 
 // assuming no collisions
-void move_agent(int agent_id, Agent &agent, int dimX, int dimY, std::mt19937 generator) { 
+void move_agent(int agent_id, Agent &agent, int dimX, int dimY, uint64_t seed, int step) { 
     int currX = agent.x_pos;
     int currY = agent.y_pos;
 
@@ -139,12 +145,10 @@ void move_agent(int agent_id, Agent &agent, int dimX, int dimY, std::mt19937 gen
 
     // N E S W
     // 0 1 2 3
-    std::uniform_int_distribution<int> dist_2(0, 1);
-    std::uniform_int_distribution<int> dist_3(0, 2);
 
     if(currX == 0 && currY == 0){ // top left
         // only options are E and S
-        int next_dir = dist_2(generator); 
+        int next_dir = corner_coin(seed, agent_id, step); 
         if (next_dir == 0){
             direction = 1;
         }
@@ -154,7 +158,7 @@ void move_agent(int agent_id, Agent &agent, int dimX, int dimY, std::mt19937 gen
     } 
     else if (currX == dimX-1 && currY == 0){ // top right
         // only options are S and W
-        int next_dir = dist_2(generator); 
+        int next_dir = corner_coin(seed, agent_id, step); 
         if (next_dir == 0) {
             direction = 2;
         }
@@ -164,7 +168,7 @@ void move_agent(int agent_id, Agent &agent, int dimX, int dimY, std::mt19937 gen
     }
     else if (currX == 0 && currY == dimY-1){ // bottom left
          // only options are N and E
-        int next_dir = dist_2(generator); 
+        int next_dir = corner_coin(seed, agent_id, step); 
         if (next_dir == 0) {
             direction = 0;
         }
@@ -174,7 +178,7 @@ void move_agent(int agent_id, Agent &agent, int dimX, int dimY, std::mt19937 gen
     }
     else if (currX == dimX-1 && currY == dimY-1 ){ // bottom right
         // only options are N and W
-        int next_dir = dist_2(generator);
+        int next_dir = corner_coin(seed, agent_id, step);
         if (next_dir == 0) {
             direction = 0;
         }
@@ -221,7 +225,7 @@ void move_agent(int agent_id, Agent &agent, int dimX, int dimY, std::mt19937 gen
     return;
 }
 
-/*
+#ifdef VISUALIZE
 void render_agents(SDL_Renderer* renderer, const std::vector<Agent>& agents, int dim_x, int dim_y, const std::vector<std::tuple<int, int, int>>& agent_colors) {
     SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255); // white background
     SDL_RenderClear(renderer);
@@ -243,7 +247,7 @@ void render_agents(SDL_Renderer* renderer, const std::vector<Agent>& agents, int
 }
 
 
- void visualize_simulation(std::vector<Agent>& agents, int dim_x, int dim_y, int num_agents, int num_iterations,  const std::vector<std::tuple<int, int, int>>& agent_colors) {
+ void visualize_simulation(std::vector<Agent>& agents, int dim_x, int dim_y, int num_agents, int num_iterations, uint64_t seed, const std::vector<std::tuple<int, int, int>>& agent_colors) {
     SDL_Init(SDL_INIT_VIDEO);
     SDL_Window* window = SDL_CreateWindow("Crowd Simulation",
                                           SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
@@ -266,9 +270,7 @@ void render_agents(SDL_Renderer* renderer, const std::vector<Agent>& agents, int
         }
 
         for (int i = 0; i < num_agents; i++) {
-            std::random_device rd;
-            std::mt19937 generator(rd());
-            move_agent(i, agents[i], dim_x, dim_y, generator);
+            move_agent(i, agents[i], dim_x, dim_y, seed, iteration_count);
         }
 
         check_collisions(agents, num_agents, dim_x, dim_y);
@@ -288,7 +290,7 @@ void render_agents(SDL_Renderer* renderer, const std::vector<Agent>& agents, int
     SDL_DestroyWindow(window);
     SDL_Quit();
 }
-*/
+#endif
 
 
 int main(int argc, char *argv[]) {
@@ -296,9 +298,10 @@ int main(int argc, char *argv[]) {
  
     std::string input_filename;
     int num_iterations = 0;
+    uint64_t seed = std::random_device{}();
 
     int opt;
-    while ((opt = getopt(argc, argv, "f:i:")) != -1) {
+    while ((opt = getopt(argc, argv, "f:i:s:")) != -1) {
         switch (opt) {
         case 'f':
             input_filename = optarg;
@@ -306,6 +309,9 @@ int main(int argc, char *argv[]) {
         case 'i':
             num_iterations = atoi(optarg);
             break;
+        case 's':
+            seed = strtoull(optarg, nullptr, 10);
+            break;
 
         default:
             std::cerr << "Usage: " << argv[0] << " -f input_filename\n";
@@ -319,26 +325,15 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
  
-    std::ifstream fin(input_filename);
+    int dim_x, dim_y;
+    std::vector<Agent> agents;
  
-    if (!fin) {
+    // read the grid dimension and agent information from file (text or binary)
+    if (!load_scenario(input_filename, dim_x, dim_y, agents)) {
         std::cerr << "Unable to open file: " << input_filename << ".\n";
         exit(EXIT_FAILURE);
     }
- 
-    int dim_x, dim_y;
-    int num_agents;
- 
-    // read the grid dimension and agent information from file 
-    fin >> dim_x >> dim_y >> num_agents;
- 
-    std::vector<Agent> agents(num_agents);
-
-    for (auto& agent : agents) {
-        fin >> agent.x_pos >> agent.y_pos >> agent.dir;
-        agent.next_x = agent.x_pos;
-        agent.next_y = agent.y_pos;
-    }
+    int num_agents = (int)agents.size();
 
     std::vector<std::tuple<int, int, int>> agent_colors;
 
@@ -346,11 +341,13 @@ int main(int argc, char *argv[]) {
     std::mt19937 gen(rd());
     std::uniform_int_distribution<> color_dist(0, 255);
 
+#ifdef VISUALIZE
     for (int i = 0; i < num_agents; i++) {
         agent_colors.push_back({
             color_dist(gen), color_dist(gen), color_dist(gen)
         });
     }
+#endif
 
 
     const double init_time = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - init_start).count();
@@ -360,15 +357,16 @@ int main(int argc, char *argv[]) {
 
     int iteration_count = 0;
 
-    // uncomment the following line to use the simulation
-    // visualize_simulation(agents, dim_x, dim_y, num_agents, num_iterations, agent_colors);
+    // the visualization runs its own loop, so skip the timed one
+#ifdef VISUALIZE
+    visualize_simulation(agents, dim_x, dim_y, num_agents, num_iterations, seed, agent_colors);
+    iteration_count = num_iterations;
+#endif
 
     while (iteration_count < num_iterations) {
 
         for (int i = 0; i < num_agents; i++) {
-            std::random_device rd;  
-            std::mt19937 generator(rd()); 
-            move_agent(i, agents[i], dim_x, dim_y, generator);
+            move_agent(i, agents[i], dim_x, dim_y, seed, iteration_count);
         }
 
         check_collisions(agents, num_agents, dim_x, dim_y);
@@ -0,0 +1,109 @@
+/**
+ * Quadtree Split Tuner
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #include <algorithm>
+ #include <cmath>
+
+ #include "split_tuner.h"
+
+ const int min_leaf_side = 16;
+
+ static void walk_leaves(Quadtree *node, LeafStats& stats) {
+     if (!node->is_leaf()) {
+         for (int i = 0; i < 4; i++) {
+             walk_leaves(node->child(i), stats);
+         }
+         return;
+     }
+
+     int occupancy = (int)node->agents.size();
+     stats.leaves++;
+     stats.max_occupancy = std::max(stats.max_occupancy, occupancy);
+     if (occupancy == 0) {
+         stats.empty_leaves++;
+     }
+     if (occupancy > max_agents && node->depth >= max_depth) {
+         stats.capped_leaves++;
+         stats.agents_in_capped += occupancy;
+     }
+ }
+
+ LeafStats collect_leaf_stats(Quadtree *qt) {
+     LeafStats stats;
+     walk_leaves(qt, stats);
+     return stats;
+ }
+
+ int depth_limit(int dim_x, int dim_y) {
+     int side = std::min(dim_x, dim_y);
+     int depth = 0;
+     while ((side >> (depth + 1)) >= min_leaf_side) {
+         depth++;
+     }
+     return std::max(depth, 1);
+ }
+
+ void pick_split_from_density(int dim_x, int dim_y, int num_agents) {
+     // the refresh walks and migrations grow with depth faster than the
+     // detection scans shrink, so aim for fairly full leaves
+     max_agents = 16;
+
+     // shallowest tree with room for 4^depth leaves of max_agents each
+     int depth = 1;
+     while (depth < 30 && std::pow(4.0, depth) * max_agents < num_agents) {
+         depth++;
+     }
+     max_depth = std::min(depth, depth_limit(dim_x, dim_y));
+ }
+
+ SplitTuner::SplitTuner(int dim_x, int dim_y):
+ limit(depth_limit(dim_x, dim_y)), steps(0), window_cost(0), trial(false), trial_dir(0),
+ best_depth(max_depth), best_cost(0), rest{0, 0} {}
+
+ bool SplitTuner::after_step(Quadtree *qt, int num_agents, double step_cost) {
+     window_cost += step_cost;
+     if (++steps < window) {
+         return false;
+     }
+     double cost = window_cost / window;
+     steps = 0;
+     window_cost = 0;
+
+     if (trial) {
+         trial = false;
+         int dir_index = trial_dir > 0 ? 0 : 1;
+         if (cost >= best_cost) {
+             // slower, go back and leave this direction alone for a while
+             rest[dir_index] = std::max(1, 2 * rest[dir_index]);
+             max_depth = best_depth;
+             return true;
+         }
+         rest[dir_index] = 0;
+     }
+     best_cost = cost;
+     best_depth = max_depth;
+
+     for (int d = 0; d < 2; d++) {
+         if (rest[d] > 0) {
+             rest[d]--;
+         }
+     }
+
+     LeafStats stats = collect_leaf_stats(qt);
+     int used_leaves = stats.leaves - stats.empty_leaves;
+     if (rest[0] == 0 && max_depth < limit && stats.agents_in_capped * 10 > num_agents) {
+         trial_dir = 1;
+     }
+     else if (rest[1] == 0 && max_depth > 1 && stats.empty_leaves > 2 * used_leaves) {
+         trial_dir = -1;
+     }
+     else {
+         return false;
+     }
+
+     trial = true;
+     max_depth += trial_dir;
+     return true;
+ }
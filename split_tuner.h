@@ -0,0 +1,58 @@
+/**
+ * Quadtree Split Tuner (Header file)
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #ifndef SPLIT_TUNER_H
+ #define SPLIT_TUNER_H
+
+ #include "quadtree.h"
+
+ struct LeafStats {
+     int leaves = 0;
+     int empty_leaves = 0;
+     // leaves over max_agents that cannot split because they hit max_depth
+     int capped_leaves = 0;
+     int agents_in_capped = 0;
+     int max_occupancy = 0;
+ };
+
+ LeafStats collect_leaf_stats(Quadtree *qt);
+
+ // Deepest split that still leaves cells of min_leaf_side or more; smaller
+ // leaves only repeat the same agents through the getMultiQuadrant margin.
+ int depth_limit(int dim_x, int dim_y);
+
+ // Sets max_agents and max_depth from the average density, deep enough that
+ // a uniform crowd ends up with at most max_agents agents per leaf.
+ void pick_split_from_density(int dim_x, int dim_y, int num_agents);
+
+ // Adjusts max_depth between steps. Every window steps it looks at the leaf
+ // occupancy and tries one level deeper when many agents sit in leaves stuck
+ // at max_depth, or one level shallower when most leaves are empty. The trial
+ // is kept if the next window's refresh + detect time is lower and undone
+ // otherwise, after which that direction rests for a growing number of
+ // windows.
+ class SplitTuner {
+     public:
+         SplitTuner(int dim_x, int dim_y);
+
+         // step_cost is the refresh + detect time of the step just finished.
+         // Returns true when max_depth changed and the tree must be rebuilt.
+         bool after_step(Quadtree *qt, int num_agents, double step_cost);
+
+     private:
+         static const int window = 10;
+
+         int limit;
+         int steps;
+         double window_cost;
+
+         bool trial;
+         int trial_dir;
+         int best_depth;
+         double best_cost;
+         int rest[2];
+ };
+
+ #endif
@@ -0,0 +1,194 @@
+/**
+ * Specialized Step Kernels
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #include <utility>
+
+ #include "step_kernels.h"
+ #include "rng.h"
+
+ // N E S W
+ // 0 1 2 3
+ constexpr int dir_dx[4] = {0, 1, 0, -1};
+ constexpr int dir_dy[4] = {-1, 0, 1, 0};
+ constexpr int dir_reverse[4] = {2, 3, 0, 1};
+
+ // the two ways out of each corner, indexed by (x on the right) | (y on the
+ // bottom) << 1 and then by the corner coin
+ constexpr int corner_exits[4][2] = {{1, 2}, {2, 3}, {0, 1}, {0, 3}};
+
+ const int min_log_dim = 4;
+ const int max_log_dim = 16;
+ const int resolve_chunk = 1024;
+
+ // LogDim > 0: a 2^LogDim square grid, known at compile time.
+ // LogDim == 0: any grid, bounds read from dim_x and dim_y.
+ template <int LogDim>
+ struct GridBounds {
+     int dim_x, dim_y;
+
+     int max_x() const {
+         if constexpr (LogDim > 0) {
+             return (1 << LogDim) - 1;
+         }
+         else {
+             return dim_x - 1;
+         }
+     }
+
+     int max_y() const {
+         if constexpr (LogDim > 0) {
+             return (1 << LogDim) - 1;
+         }
+         else {
+             return dim_y - 1;
+         }
+     }
+
+     // a negative coordinate wraps to a large unsigned value, so one test
+     // covers both sides
+     bool in_x(int x) const {
+         if constexpr (LogDim > 0) {
+             return ((unsigned)x >> LogDim) == 0;
+         }
+         else {
+             return (unsigned)x < (unsigned)dim_x;
+         }
+     }
+
+     bool in_y(int y) const {
+         if constexpr (LogDim > 0) {
+             return ((unsigned)y >> LogDim) == 0;
+         }
+         else {
+             return (unsigned)y < (unsigned)dim_y;
+         }
+     }
+ };
+
+ // Same rules as move_agent: a corner picks one of its two exits with the
+ // corner coin, an agent about to walk off an edge turns around, and every
+ // other agent keeps its direction.
+ template <int LogDim>
+ static inline void step_agent(const GridBounds<LogDim>& bounds, int agent_id, Agent& agent, uint64_t seed, int step) {
+     int x = agent.x_pos;
+     int y = agent.y_pos;
+     int dir = agent.dir;
+
+     bool x_edge = (x == 0 || x == bounds.max_x());
+     bool y_edge = (y == 0 || y == bounds.max_y());
+     if (x_edge && y_edge) {
+         int corner = (x != 0) | ((y != 0) << 1);
+         dir = corner_exits[corner][corner_coin(seed, agent_id, step)];
+     }
+     else if ((unsigned)dir < 4 && !(bounds.in_x(x + dir_dx[dir]) && bounds.in_y(y + dir_dy[dir]))) {
+         dir = dir_reverse[dir];
+     }
+
+     agent.dir = dir;
+     agent.next_x = x;
+     agent.next_y = y;
+     if ((unsigned)dir < 4) {
+         agent.next_x += dir_dx[dir];
+         agent.next_y += dir_dy[dir];
+     }
+ }
+
+ // Same rules as bounce_agent: reverse, and step back along the new direction
+ // unless that leaves the grid. The other coordinate of the target is kept.
+ template <int LogDim>
+ static inline void bounce(const GridBounds<LogDim>& bounds, Agent& agent) {
+     int dir = dir_reverse[(unsigned)agent.dir < 4 ? agent.dir : 3];
+     agent.dir = dir;
+     if (dir_dx[dir] == 0) {
+         int next_y = agent.y_pos + dir_dy[dir];
+         agent.next_y = bounds.in_y(next_y) ? next_y : agent.y_pos;
+     }
+     else {
+         int next_x = agent.x_pos + dir_dx[dir];
+         agent.next_x = bounds.in_x(next_x) ? next_x : agent.x_pos;
+     }
+ }
+
+ template <int LogDim>
+ static void move_team(std::vector<Agent>& agents, int num_agents, const std::vector<int>& original_id,
+                       int dim_x, int dim_y, uint64_t seed, int step) {
+     const GridBounds<LogDim> bounds{dim_x, dim_y};
+     #pragma omp for schedule(static) nowait
+     for (int i = 0; i < num_agents; i++) {
+         step_agent(bounds, original_id[i], agents[i], seed, step);
+     }
+ }
+
+ template <int LogDim>
+ static void resolve_collisions_team(const std::vector<int>& colliders, std::vector<Agent>& agents, int num_agents,
+                                     int dim_x, int dim_y) {
+     const GridBounds<LogDim> bounds{dim_x, dim_y};
+     // most agents have no collider, so hand out blocks rather than single
+     // agents to keep the scheduling cost below the work
+     #pragma omp for schedule(dynamic, resolve_chunk) nowait
+     for (int i = 0; i < num_agents; i++) {
+         int collider_id = colliders[i];
+         if (collider_id != -1 && collider_id > i) {
+             bounce(bounds, agents[i]);
+             bounce(bounds, agents[collider_id]);
+         }
+     }
+ }
+
+ // an agent outside the active set has no collider, and neither has anyone
+ // it could have collided with, so the pairs are the same as over everybody
+ template <int LogDim>
+ static void resolve_collisions_active_team(const std::vector<int>& colliders, std::vector<Agent>& agents,
+                                            const std::vector<int>& active, int dim_x, int dim_y) {
+     const GridBounds<LogDim> bounds{dim_x, dim_y};
+     int num_active = (int)active.size();
+     #pragma omp for schedule(dynamic, resolve_chunk) nowait
+     for (int k = 0; k < num_active; k++) {
+         int i = active[k];
+         int collider_id = colliders[i];
+         if (collider_id != -1 && collider_id > i) {
+             bounce(bounds, agents[i]);
+             bounce(bounds, agents[collider_id]);
+         }
+     }
+ }
+
+ template <int LogDim>
+ static void resolve_conflicts_team(const std::vector<char>& in_conflict, std::vector<Agent>& agents, int num_agents,
+                                    int dim_x, int dim_y) {
+     const GridBounds<LogDim> bounds{dim_x, dim_y};
+     #pragma omp for schedule(static) nowait
+     for (int i = 0; i < num_agents; i++) {
+         if (in_conflict[i]) {
+             bounce(bounds, agents[i]);
+         }
+     }
+ }
+
+ template <int LogDim>
+ static StepKernels make_kernels() {
+     return {LogDim, move_team<LogDim>, resolve_collisions_team<LogDim>, resolve_collisions_active_team<LogDim>,
+             resolve_conflicts_team<LogDim>};
+ }
+
+ // one entry per specialized side length, indexed by log_dim - min_log_dim
+ template <int... Logs>
+ static StepKernels pick(int log_dim, std::integer_sequence<int, Logs...>) {
+     static const StepKernels table[] = {make_kernels<min_log_dim + Logs>()...};
+     return table[log_dim - min_log_dim];
+ }
+
+ StepKernels select_step_kernels(int dim_x, int dim_y) {
+     if (dim_x == dim_y && dim_x > 0 && (dim_x & (dim_x - 1)) == 0) {
+         int log_dim = 0;
+         while ((1 << log_dim) < dim_x) {
+             log_dim++;
+         }
+         if (log_dim >= min_log_dim && log_dim <= max_log_dim) {
+             return pick(log_dim, std::make_integer_sequence<int, max_log_dim - min_log_dim + 1>());
+         }
+     }
+     return make_kernels<0>();
+ }
@@ -0,0 +1,39 @@
+/**
+ * Specialized Step Kernels (Header file)
+ * Elly Zheng (ellyz), Rose Liu (roseliu)
+ */
+
+ #ifndef STEP_KERNELS_H
+ #define STEP_KERNELS_H
+
+ #include <cstdint>
+ #include <vector>
+ #include "agent.h"
+
+ // The move and resolve phases of the main loop, compiled once per grid shape.
+ // Square grids of 2^4 to 2^16 cells a side get a version where the grid size
+ // is a template constant, so every bounds check is a shift, and the others
+ // get the generic version that compares against the runtime dimensions. Both
+ // step through direction tables instead of one branch per direction, and
+ // give the same moves as move_agent and bounce_agent.
+ //
+ // The functions only hold worksharing loops (nowait), like the *_team
+ // functions in parallel.cpp, so they run on the caller's team.
+ struct StepKernels {
+     // log2 of the side length the kernels are specialized for, 0 for generic
+     int log_dim;
+
+     void (*move_team)(std::vector<Agent>& agents, int num_agents, const std::vector<int>& original_id,
+                       int dim_x, int dim_y, uint64_t seed, int step);
+     void (*resolve_collisions_team)(const std::vector<int>& colliders, std::vector<Agent>& agents, int num_agents,
+                                     int dim_x, int dim_y);
+     // resolve_collisions_team over the agents listed in active only
+     void (*resolve_collisions_active_team)(const std::vector<int>& colliders, std::vector<Agent>& agents,
+                                            const std::vector<int>& active, int dim_x, int dim_y);
+     void (*resolve_conflicts_team)(const std::vector<char>& in_conflict, std::vector<Agent>& agents, int num_agents,
+                                    int dim_x, int dim_y);
+ };
+
+ StepKernels select_step_kernels(int dim_x, int dim_y);
+
+ #endif